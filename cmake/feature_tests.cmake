@@ -110,6 +110,41 @@ endif()
 
 CHECK_FUNCTION_EXISTS(getrusage TALTOS_CAN_USE_GETRUSAGE)
 
+# mmap and madvise are used to back the transposition table with huge pages
+CHECK_C_SOURCE_COMPILES("
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
+int main() {
+	void *p = mmap(0, 4096, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return munmap(p, 4096);
+}
+"
+ TALTOS_CAN_USE_POSIX_MMAP)
+
+if(TALTOS_CAN_USE_POSIX_MMAP)
+	CHECK_C_SOURCE_COMPILES("
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
+int main() {
+	void *p = mmap(0, 1 << 21, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	return munmap(p, 1 << 21);
+}
+"
+	 TALTOS_CAN_USE_MAP_HUGETLB)
+
+	CHECK_C_SOURCE_COMPILES("
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
+int main() {
+	static char buffer[4096];
+	return madvise(buffer, sizeof(buffer), MADV_HUGEPAGE);
+}
+"
+	 TALTOS_CAN_USE_MADV_HUGEPAGE)
+endif()
+
 
 include(cmake/feature_tests_gcc.cmake)
 include(cmake/feature_tests_intel.cmake)
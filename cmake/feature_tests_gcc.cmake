@@ -139,6 +139,19 @@ int main() {
 "
  TALTOS_CAN_USE_BUILTIN_BSWAP64)
 
+CHECK_C_SOURCE_COMPILES("
+#include <stdint.h>
+__extension__ typedef unsigned __int128 uint128;
+uint64_t something(uint64_t x, uint64_t y)
+{
+	return (uint64_t)(((uint128)x * y) >> 64);
+}
+int main() {
+	return 0;
+}
+"
+ TALTOS_CAN_USE_GNU_UINT128)
+
 check_c_compiler_flag(-flax-vector-conversions HAS_FLAX_VCONVS)
 check_c_compiler_flag(-mno-vzeroupper HAS_MNO_VZEROUPPER)
 
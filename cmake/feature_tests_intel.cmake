@@ -126,6 +126,7 @@ int main() {
 "
  TALTOS_CAN_USE_INTEL_POPCOUNT64)
 
+if(NOT TALTOS_FORCE_NO_PEXT)
 CHECK_C_SOURCE_COMPILES("
 #include <stdint.h>
 #include <immintrin.h>
@@ -138,6 +139,7 @@ int main() {
 }
 "
  TALTOS_CAN_USE_INTEL_PDEP_PEXT_64)
+endif()
 
 CHECK_C_SOURCE_COMPILES("
 #include <xmmintrin.h>
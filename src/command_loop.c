@@ -61,6 +61,8 @@ static jmp_buf command_error;
 static int error_condition;
 static char *line_lasts;
 static uintmax_t callback_key;
+static struct move_order_stats last_move_order_stats;
+static bool has_move_order_stats;
 static mtx_t stdout_mutex;
 static mtx_t game_mutex;
 
@@ -111,6 +113,7 @@ static const char *features[] = {
 	"sigint=1",
 	"reuse=1",
 	"memory=1",
+	"smp=1",
 	NULL
 };
 
@@ -275,6 +278,8 @@ set_uci(void)
 	printf("id author %s", author_name);
 	printf("option name Hash type spin default %u min %u max %u\n",
 	    conf->hash_table_size_mb, ht_min_size_mb(), ht_max_size_mb());
+	printf("option name Threads type spin default %u min 1 max %u\n",
+	    conf->thread_count, (unsigned)MAX_THREAD_COUNT);
 	puts("uciok");
 }
 
@@ -376,6 +381,8 @@ print_computer_move(move m)
 	mtx_unlock(&stdout_mutex);
 }
 
+static void print_last_move_order_stats(void);
+
 static int
 computer_move(uintmax_t key)
 {
@@ -386,6 +393,8 @@ computer_move(uintmax_t key)
 
 	mtx_lock(&game_mutex);
 
+	print_last_move_order_stats();
+
 	if (engine_get_best_move(&m) != 0) {
 		puts("-");
 	}
@@ -493,7 +502,7 @@ static void
 print_result_header(void)
 {
 	if (verbose)
-		printf("  D\tQD\ttime\tvalue\tfmc\thuse\tnodes\tqnodes\tPV\n");
+		printf("  D\tQD\ttime\tvalue\tfmc\thuse\tphit\trs\tnodes\tqnodes\tPV\n");
 	else
 		printf("  D\ttime\tvalue\tnodes\tPV\n");
 }
@@ -510,6 +519,57 @@ print_verbose_search_info(struct engine_result res)
 	putchar('\t');
 	print_percent(res.ht_usage);
 	putchar('\t');
+	if (sres.pawn_cache_probes > 0)
+		print_percent((int)((sres.pawn_cache_hits * 1000)
+		    / sres.pawn_cache_probes));
+	else
+		print_percent(0);
+	putchar('\t');
+	printf("%u\t", sres.aspiration_research_count);
+}
+
+static void
+print_move_order_stats(const struct move_order_stats *stats)
+{
+	static const char *stage_names[] = {
+		[mo_stage_strong_captures] = "strong captures",
+		[mo_stage_captures] = "captures",
+		[mo_stage_killers] = "killers",
+		[mo_stage_rest] = "quiet moves"
+	};
+
+	for (unsigned i = 0; i < mo_stage_count; ++i) {
+		if (stats->stage_runs[i] == 0)
+			continue;
+
+		printf("\t%s: %ju runs %ju moves", stage_names[i],
+		    stats->stage_runs[i], stats->stage_moves[i]);
+		if (stats->stage_nanoseconds[i] > 0)
+			printf(" %juns/run", stats->stage_nanoseconds[i]
+			    / stats->stage_runs[i]);
+		putchar('\n');
+	}
+
+	if (stats->cheap_scored_moves > 0)
+		printf("\tcheaply scored moves: %ju\n",
+		    stats->cheap_scored_moves);
+}
+
+/*
+ * The move ordering statistics are collected over all iterations, and
+ * are only printed once, when the search is done.
+ */
+static void
+print_last_move_order_stats(void)
+{
+	mtx_lock(&stdout_mutex);
+
+	if (has_move_order_stats) {
+		print_move_order_stats(&last_move_order_stats);
+		has_move_order_stats = false;
+	}
+
+	mtx_unlock(&stdout_mutex);
 }
 
 static void
@@ -583,6 +643,10 @@ print_current_result(struct engine_result res)
 			print_verbose_search_info(res);
 		(void) print_nice_count(res.sresult.node_count);
 		printf("N\t");
+		if (verbose) {
+			(void) print_nice_count(res.sresult.qnode_count);
+			printf("N\t");
+		}
 	}
 
 	if (is_uci)
@@ -590,6 +654,11 @@ print_current_result(struct engine_result res)
 	print_move_path(game, res.pv);
 	putchar('\n');
 
+	if (verbose && !is_xboard && !is_uci) {
+		last_move_order_stats = res.sresult.move_order_stats;
+		has_move_order_stats = true;
+	}
+
 	mtx_unlock(&stdout_mutex);
 	mtx_unlock(&game_mutex);
 }
@@ -700,11 +769,11 @@ get_int(int min, int max)
 }
 
 static unsigned
-get_uint(unsigned min, unsigned max)
+parse_uint(const char *str, unsigned min, unsigned max)
 {
 	long long n;
 
-	n = get_num_arg(get_str_arg());
+	n = get_num_arg(str);
 	if (n < (long long)min) {
 		(void) fprintf(stderr, "Number too low: %lld\n", n);
 		param_error();
@@ -716,6 +785,12 @@ get_uint(unsigned min, unsigned max)
 	return (unsigned)n;
 }
 
+static unsigned
+get_uint(unsigned min, unsigned max)
+{
+	return parse_uint(get_str_arg(), min, max);
+}
+
 static void
 cmd_perft(void)
 {
@@ -1063,6 +1138,14 @@ set_verbosity(void)
 	set_var_onoff(&verbose);
 }
 
+static void
+set_move_order_timing(void)
+{
+	mtx_lock(conf->mutex);
+	set_var_onoff(&conf->search.use_move_order_timing);
+	mtx_unlock(conf->mutex);
+}
+
 static void
 set_exitondone(void)
 {
@@ -1079,6 +1162,8 @@ search_cb(uintmax_t key)
 
 	mtx_lock(&game_mutex);
 
+	print_last_move_order_stats();
+
 	if (engine_get_best_move(&m) == 0) {
 		print_computer_move(m);
 		set_thinking_done_cb(computer_move, ++callback_key);
@@ -1258,16 +1343,20 @@ cmd_polyglotkey(void)
 }
 
 static void
-cmd_hash_size(void)
+print_hash_size(void)
 {
-	mtx_lock(&stdout_mutex);
-
 	/* BEGIN CSTYLED */ /* cstyle does not know about this syntax yet */
 	print_nice_number(engine_ht_size(),
 	    (const char *[]) {"b", "kb", "mb", "gb", NULL},
 	    (const uintmax_t[]) {1, 1024, 1024 * 1024, 1024 * 1024 * 1024, 0});
 	/* END CSTYLED */
+}
 
+static void
+cmd_hash_size(void)
+{
+	mtx_lock(&stdout_mutex);
+	print_hash_size();
 	mtx_unlock(&stdout_mutex);
 }
 
@@ -1488,16 +1577,20 @@ cmd_position(void)
 static void
 cmd_memory(void)
 {
-	unsigned value = get_uint(ht_min_size_mb(), ht_max_size_mb());
+	const char *arg = get_str_arg_opt();
 
-	tracef("repro: memory %u", value);
+	if (arg == NULL) {
+		// Report the current size, and the kind of pages backing it
+		mtx_lock(&stdout_mutex);
+		print_hash_size();
+		printf(" %s\n", engine_ht_backing());
+		mtx_unlock(&stdout_mutex);
+		return;
+	}
 
-	value |= value >> 1;
-	value |= value >> 2;
-	value |= value >> 4;
-	value |= value >> 8;
-	value |= value >> 16;
-	value = (value + 1) >> 1;
+	unsigned value = parse_uint(arg, ht_min_size_mb(), ht_max_size_mb());
+
+	tracef("repro: memory %u", value);
 
 	mtx_lock(conf->mutex);
 	conf->hash_table_size_mb = value;
@@ -1505,6 +1598,58 @@ cmd_memory(void)
 	engine_conf_change();
 }
 
+static void
+cmd_hash_save(void)
+{
+	const char *path = xstrtok_r(NULL, "\n\r", &line_lasts);
+
+	if (path == NULL)
+		param_error();
+
+	if (engine_ht_save(path) != 0) {
+		(void) fprintf(stderr, "Unable to save hash table to %s\n", path);
+		general_error();
+	}
+}
+
+static void
+cmd_hash_load(void)
+{
+	const char *path = xstrtok_r(NULL, "\n\r", &line_lasts);
+
+	if (path == NULL)
+		param_error();
+
+	if (engine_ht_load(path) != 0) {
+		(void) fprintf(stderr,
+		    "Unable to load hash table from %s\n", path);
+		general_error();
+	}
+
+	/*
+	 * Keep the configured size in sync with the size of the loaded table,
+	 * otherwise it would be resized - and cleared - upon the next search.
+	 * The size is rounded up to megabytes, which ht_resize_mb accepts as
+	 * the size of the table, even when it is not an exact multiple.
+	 */
+	mtx_lock(conf->mutex);
+	conf->hash_table_size_mb = engine_ht_size_mb();
+	mtx_unlock(conf->mutex);
+}
+
+static void
+cmd_cores(void)
+{
+	unsigned value = get_uint(1, MAX_THREAD_COUNT);
+
+	tracef("repro: cores %u", value);
+
+	mtx_lock(conf->mutex);
+	conf->thread_count = value;
+	mtx_unlock(conf->mutex);
+	engine_conf_change();
+}
+
 static void
 cmd_setoption(void)
 {
@@ -1526,6 +1671,9 @@ cmd_setoption(void)
 	if (strcmp(name, "Hash") == 0) {
 		cmd_memory();
 	}
+	else if (strcmp(name, "Threads") == 0) {
+		cmd_cores();
+	}
 	else {
 		return;
 	}
@@ -1759,6 +1907,7 @@ static struct cmd_entry cmd_list[] = {
 	{"undo",         cmd_undo,               NULL},
 	{"redo",         cmd_redo,               NULL},
 	{"verbose",      set_verbosity,          "on|off"},
+	{"mo_timing",    set_move_order_timing,  "on|off"},
 	{"setmovenot",   cmd_setmovenot,         "coor|san"},
 	{"getmovenot",   cmd_getmovenot,         NULL},
 	{"ping",         cmd_ping,               NULL},
@@ -1767,12 +1916,15 @@ static struct cmd_entry cmd_list[] = {
 	{"polyglot_key", cmd_polyglotkey,        NULL},
 	{"hash_size",    cmd_hash_size,          NULL},
 	{"hash_entry",   cmd_hash_entry,         NULL},
+	{"hash_save",    cmd_hash_save,          "path"},
+	{"hash_load",    cmd_hash_load,          "path"},
 	{"hash_value_min",
 		cmd_hash_value_exact_min,        NULL},
 	{"hash_value_max",
 		cmd_hash_value_exact_max,        NULL},
 	{"position",     cmd_position,           NULL},
-	{"memory",       cmd_memory,             NULL},
+	{"memory",       cmd_memory,             "[megabytes]"},
+	{"cores",        cmd_cores,              NULL},
 	{"uci",          set_uci,                NULL},
 	{"isready",      cmd_isready,            NULL},
 	{"setoption",    cmd_setoption,          NULL},
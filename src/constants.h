@@ -143,5 +143,7 @@ extern const uint64_t bishop_masks[64];
 extern const uint64_t rook_masks[64];
 extern const uint64_t pawn_attacks_north[64];
 extern const uint64_t pawn_attacks_south[64];
+extern const uint64_t bishop_magic_numbers[64];
+extern const uint64_t rook_magic_numbers[64];
 
 #endif
@@ -248,10 +248,16 @@ set_opponent_clock(unsigned t)
 /*	Threads	*/
 
 /*
- * All positions since the last irreversible move.
+ * The current position in the game.
+ */
+static struct position current_position;
+
+/*
+ * The Zobrist keys of all positions since the last irreversible move,
+ * the last one being the key of the current position.
  * Needed for three-fold repetition detection.
  */
-static struct position history[1024];
+static uint64_t history[1024][2];
 static unsigned history_length;
 
 /*
@@ -271,8 +277,20 @@ static uintmax_t thinking_cb_arg;
 static taltos_systime thinking_started;
 
 static void (*show_thinking_cb)(const struct engine_result);
+
+/*
+ * The number of threads used in the current search. The first thread is
+ * the main thread, the rest are helper threads in a lazy SMP fashion: they
+ * all search the same root position, and communicate with each other
+ * via the transposition table only.
+ */
 static unsigned thread_count = 1;
 
+/*
+ * The transposition table, shared by all search threads.
+ */
+static struct hash_table *hash_table;
+
 struct search_thread_data {
 	thrd_t thr;
 
@@ -290,81 +308,61 @@ struct search_thread_data {
 	 */
 	bool is_started_flag;
 
+	/*
+	 * The number of nodes searched by a helper thread in the
+	 * iterations it completed, added to the main thread's results
+	 * when reporting.
+	 */
+	uintmax_t node_count;
+
+	/*
+	 * Move ordering statistics, kept by the thread across searches,
+	 * allocated when the thread is first started.
+	 */
+	struct move_history *move_history;
+
 	struct position root;
 	struct search_description sd;
 	bool export_best_move;
+	bool is_helper;
 	void (*thinking_cb)(void);
 	void (*show_thinking_cb)(const struct engine_result);
 };
 
 static struct search_thread_data threads[MAX_THREAD_COUNT];
 
-static int
-board_cmp(const struct position *a, const struct position *b)
+static void
+add_history_key(const struct position *pos)
 {
-	return memcmp(a->board, b->board, sizeof(a->board));
+	history[history_length][0] = pos->zhash[0];
+	history[history_length][1] = pos->zhash[1];
+	++history_length;
 }
 
-static size_t
-filter_duplicates(struct position duplicates[], bool *is_root_duplicate)
+/*
+ * Lets the search find repetitions of positions from the game played so
+ * far, by passing it the Zobrist keys of the positions before the root.
+ */
+static void
+setup_game_history(struct search_description *sd)
 {
-	trace(__func__);
-
-	size_t count = 0;
-	enum player turn = debug_player_to_move;
-	*is_root_duplicate = false;
-
-	if ((history_length % 2) == 0)
-		turn = opponent_of(turn);
+	unsigned count = history_length - 1;
 
-	for (unsigned i = 0; i < history_length - 1; ++i) {
-		for (unsigned j = i + 1; j < history_length; ++j) {
-			if ((i - j) % 2 == 0
-			    && board_cmp(history + i, history + j) == 0) {
-				if (j == history_length - 1)
-					*is_root_duplicate = true;
+	if (count > ARRAY_LENGTH(sd->game_history))
+		count = ARRAY_LENGTH(sd->game_history);
 
-				char fen[0x1000];
-				position_print_fen(history + i, fen, 0, turn);
-				tracef("Duplicate found: %s", fen);
-
-				duplicates[count++] = history[i];
-				break;
-			}
-		}
-		turn = opponent_of(turn);
+	for (unsigned i = 0; i < count; ++i) {
+		sd->game_history[i][0] = history[history_length - 2 - i][0];
+		sd->game_history[i][1] = history[history_length - 2 - i][1];
 	}
-	return count;
-}
-
-static void
-add_history_as_repetition(void)
-{
-	trace(__func__);
 
-	static struct position duplicates[ARRAY_LENGTH(history)];
-
-	size_t duplicate_count;
-	ht_entry entry = ht_set_depth(HT_NULL, 99);
-	entry = ht_set_value(entry, vt_exact, 0);
-	bool is_root_duplicate;
-
-	duplicate_count = filter_duplicates(duplicates, &is_root_duplicate);
-	for (unsigned ti = 0; ti < MAX_THREAD_COUNT; ++ti) {
-		struct hash_table *tt = threads[ti].sd.tt;
-		if (tt != NULL) {
-			if (is_root_duplicate)
-				ht_clear(tt);
-			for (size_t i = 0; i < duplicate_count; ++i)
-				ht_pos_insert(tt, duplicates + i, entry);
-		}
-	}
+	sd->game_history_length = count;
 }
 
 static void
-join_all_threads(bool signal_stop)
+join_threads(unsigned first, bool signal_stop)
 {
-	for (unsigned i = 0; i < MAX_THREAD_COUNT; ++i) {
+	for (unsigned i = first; i < MAX_THREAD_COUNT; ++i) {
 		struct search_thread_data *thread = threads + i;
 		mtx_lock(&engine_mutex);
 		if (thread->is_started_flag) {
@@ -384,6 +382,33 @@ join_all_threads(bool signal_stop)
 	}
 }
 
+static void
+join_all_threads(bool signal_stop)
+{
+	join_threads(0, signal_stop);
+}
+
+/*
+ * Stop the helper threads, called by the main search thread when it
+ * is done.
+ */
+static void
+stop_helper_threads(void)
+{
+	join_threads(1, true);
+}
+
+static uintmax_t
+helper_node_count(void)
+{
+	uintmax_t sum = 0;
+
+	for (unsigned i = 1; i < thread_count; ++i)
+		sum += threads[i].node_count;
+
+	return sum;
+}
+
 void
 stop_thinking(void)
 {
@@ -448,7 +473,7 @@ fill_best_move(void)
 {
 	move moves[MOVE_ARRAY_LENGTH];
 
-	if (gen_moves(history + history_length - 1, moves) != 0) {
+	if (gen_moves(&current_position, moves) != 0) {
 		engine_best_move = moves[0];
 	}
 	else {
@@ -483,9 +508,24 @@ update_engine_result(const struct search_thread_data *data,
 {
 	uintmax_t node_count_sum = dst->sresult.node_count + src->node_count;
 	uintmax_t qnode_count_sum = dst->sresult.qnode_count + src->qnode_count;
+	uintmax_t pawn_probe_sum =
+	    dst->sresult.pawn_cache_probes + src->pawn_cache_probes;
+	uintmax_t pawn_hit_sum =
+	    dst->sresult.pawn_cache_hits + src->pawn_cache_hits;
+	struct move_order_stats mo_stats = dst->sresult.move_order_stats;
+	for (unsigned i = 0; i < mo_stage_count; ++i) {
+		mo_stats.stage_runs[i] += src->move_order_stats.stage_runs[i];
+		mo_stats.stage_moves[i] += src->move_order_stats.stage_moves[i];
+		mo_stats.stage_nanoseconds[i] +=
+		    src->move_order_stats.stage_nanoseconds[i];
+	}
+	mo_stats.cheap_scored_moves += src->move_order_stats.cheap_scored_moves;
 	dst->sresult = *src;
 	dst->sresult.node_count = node_count_sum;
 	dst->sresult.qnode_count = qnode_count_sum;
+	dst->sresult.pawn_cache_probes = pawn_probe_sum;
+	dst->sresult.pawn_cache_hits = pawn_hit_sum;
+	dst->sresult.move_order_stats = mo_stats;
 	dst->time_spent = xseconds_since(data->sd.thinking_started);
 	dst->ht_usage =
 	    (int)(ht_usage(data->sd.tt) * 1000 / ht_slot_count(data->sd.tt));
@@ -497,18 +537,17 @@ update_engine_result(const struct search_thread_data *data,
 ht_entry
 engine_current_entry(void)
 {
-	if (threads[0].sd.tt == NULL)
+	if (hash_table == NULL)
 		return HT_NULL;
-	return ht_lookup_deep(threads[0].sd.tt,
-	    history + history_length - 1, 1, max_value);
+	return ht_lookup_deep(hash_table, &current_position, 1, max_value);
 }
 
 ht_entry
 engine_get_entry(const struct position *pos)
 {
-	if (threads[0].sd.tt == NULL)
+	if (hash_table == NULL)
 		return HT_NULL;
-	return ht_lookup_deep(threads[0].sd.tt, pos, 1, max_value);
+	return ht_lookup_deep(hash_table, pos, 1, max_value);
 }
 
 static void
@@ -517,17 +556,54 @@ setup_search(struct search_thread_data *thread)
 	ht_entry entry;
 
 	thread->sd.depth = PLY;
+	thread->sd.is_previous_value_valid = false;
 	entry = ht_lookup_deep(thread->sd.tt, &thread->root, 1, max_value);
 	if (ht_value_type(entry) == vt_exact && ht_depth(entry) > 0) {
-		if (ht_value(entry) == 0 && ht_depth(entry) == 99)
-			return;
-
 		thread->sd.depth = ht_depth(entry) + 1;
 		if (thread->export_best_move && ht_has_move(entry))
 			engine_best_move = ht_move(entry);
 	}
 }
 
+/*
+ * Helper threads skip some of the depths, to make them search at different
+ * depths than the main thread at any one time. The more helper threads,
+ * the larger the gaps between the depths a single helper thread visits.
+ * The pattern is described in the two tables below, both indexed by
+ * the number of the helper thread ( modulo the table size ). A depth is
+ * skipped, if ( depth + phase ) / size is odd.
+ */
+static const int skip_size[] = {
+	1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+static const int skip_phase[] = {
+	0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7
+};
+
+static_assert(ARRAY_LENGTH(skip_size) == ARRAY_LENGTH(skip_phase),
+	"skip table size mismatch");
+
+static bool
+is_depth_skipped(const struct search_thread_data *thread)
+{
+	if (!thread->is_helper)
+		return false;
+
+	size_t i = (size_t)(thread - threads - 1) % ARRAY_LENGTH(skip_size);
+	int depth = thread->sd.depth / PLY;
+
+	return ((depth + skip_phase[i]) / skip_size[i]) % 2 != 0;
+}
+
+static void
+next_depth(struct search_thread_data *thread)
+{
+	do {
+		thread->sd.depth++;
+	} while (is_depth_skipped(thread));
+}
+
 static int
 iterative_deepening(void *arg)
 {
@@ -558,16 +634,27 @@ iterative_deepening(void *arg)
 			break;
 		if (data->sd.node_count_limit > 0)
 			data->sd.node_count_limit -= result.node_count;
+		data->node_count = engine_result.sresult.node_count;
+		data->sd.previous_value = result.value;
+		data->sd.is_previous_value_valid = true;
 		engine_result.depth = data->sd.depth / PLY;
 		if (data->export_best_move && result.best_move != 0)
 			engine_best_move = result.best_move;
 		if (data->show_thinking_cb != NULL) {
-			data->show_thinking_cb(engine_result);
+			struct engine_result report = engine_result;
+			report.sresult.node_count += helper_node_count();
+			data->show_thinking_cb(report);
 			engine_result.first = false;
 		}
 		if (abs(result.value) >= mate_value)
 			break;
-		data->sd.depth++;
+		next_depth(data);
+	}
+
+	if (!data->is_helper) {
+		mtx_unlock(&engine_mutex);
+		stop_helper_threads();
+		mtx_lock(&engine_mutex);
 	}
 
 	if (engine_result.sresult.node_count <= UINT_MAX) {
@@ -611,10 +698,44 @@ get_time_for_move(void)
 }
 
 static void
-think(bool infinite, bool single_thread)
+setup_move_history(struct search_thread_data *thread)
+{
+	if (thread->move_history == NULL)
+		thread->move_history = move_history_create();
+	else
+		move_history_swap(thread->move_history);
+
+	thread->sd.move_history = thread->move_history;
+}
+
+static void
+start_helper_threads(void)
 {
-	(void) single_thread; // ignored, no paralell search implemented yet
+	for (unsigned i = 1; i < thread_count; ++i) {
+		struct search_thread_data *thread = threads + i;
+
+		thread->sd = threads[0].sd;
+		thread->sd.node_count_limit = 0;
+		thread->root = threads[0].root;
+		thread->node_count = 0;
+		thread->thinking_cb = NULL;
+		thread->show_thinking_cb = NULL;
+		thread->export_best_move = false;
+		thread->is_helper = true;
+		thread->run_flag = true;
+		setup_move_history(thread);
+
+		if (thrd_create(&thread->thr, iterative_deepening, thread)
+		    == thrd_success)
+			thread->is_started_flag = true;
+		else
+			thread->run_flag = false;
+	}
+}
 
+static void
+think(bool infinite, bool single_thread)
+{
 	trace(__func__);
 
 	mtx_lock(&engine_mutex);
@@ -623,8 +744,8 @@ think(bool infinite, bool single_thread)
 
 	thinking_started = threads[0].sd.thinking_started = xnow();
 
-	ht_swap(threads[0].sd.tt);
-	move_order_swap_history();
+	ht_next_generation(hash_table);
+	setup_move_history(threads);
 
 	if (infinite || depth_limit == 0)
 		threads[0].sd.depth_limit = -1;
@@ -657,21 +778,33 @@ think(bool infinite, bool single_thread)
 	mtx_lock(horse->mutex);
 
 	struct hash_table *new_tt =
-	    ht_resize_mb(threads[0].sd.tt, horse->hash_table_size_mb);
+	    ht_resize_mb(hash_table, horse->hash_table_size_mb);
+
+	if (single_thread)
+		thread_count = 1;
+	else
+		thread_count = horse->thread_count;
+
+	threads[0].sd.settings = horse->search;
 
 	mtx_unlock(horse->mutex);
 
 	if (new_tt != NULL)
-		threads[0].sd.tt = new_tt;
+		hash_table = new_tt;
 
+	threads[0].sd.tt = hash_table;
+	threads[0].node_count = 0;
 	threads[0].thinking_cb = &thinking_done;
 	threads[0].show_thinking_cb = show_thinking_cb;
-	threads[0].root = history[history_length - 1];
+	threads[0].root = current_position;
+	setup_game_history(&threads[0].sd);
 	threads[0].is_started_flag = true;
 	threads[0].export_best_move = true;
-	threads[0].sd.settings = horse->search;
+	threads[0].is_helper = false;
 	threads[0].run_flag = true;
 
+	start_helper_threads();
+
 	thrd_create(&threads[0].thr, iterative_deepening, &threads[0]);
 
 	mtx_unlock(&engine_mutex);
@@ -752,21 +885,18 @@ engine_process_move(move m)
 	mtx_lock(&engine_mutex);
 
 	// todo: rotate_threads();
-	struct position *pos = history + history_length;
-	position_make_move(pos, pos - 1, m);
-	if (is_move_irreversible(pos - 1, m)) {
-		history_length = 1;
-		history[0] = *pos;
+	struct position next;
+	position_make_move(&next, &current_position, m);
+	if (is_move_irreversible(&current_position, m)) {
+		history_length = 0;
 	}
-	else {
-		++history_length;
-		if (history_length > ARRAY_LENGTH(history)) {
-			tracef("%s history_length > ARRAY_LENGTH(history)",
-			    __func__);
-			abort();
-		}
+	else if (history_length == ARRAY_LENGTH(history)) {
+		tracef("%s history_length > ARRAY_LENGTH(history)",
+		    __func__);
+		abort();
 	}
-	add_history_as_repetition();
+	current_position = next;
+	add_history_key(&current_position);
 	fill_best_move();
 
 	mtx_unlock(&engine_mutex);
@@ -781,18 +911,93 @@ engine_ht_size(void)
 
 	mtx_lock(&engine_mutex);
 
-	struct hash_table *tt = threads[0].sd.tt;
+	if (hash_table == NULL)
+		size = 0;
+	else
+		size = ht_size(hash_table);
+
+	mtx_unlock(&engine_mutex);
+
+	return size;
+}
+
+unsigned
+engine_ht_size_mb(void)
+{
+	trace(__func__);
+
+	unsigned size;
 
-	if (tt == NULL)
+	mtx_lock(&engine_mutex);
+
+	if (hash_table == NULL)
 		size = 0;
 	else
-		size = ht_size(tt);
+		size = ht_size_mb(hash_table);
 
 	mtx_unlock(&engine_mutex);
 
 	return size;
 }
 
+const char*
+engine_ht_backing(void)
+{
+	trace(__func__);
+
+	const char *name;
+
+	mtx_lock(&engine_mutex);
+
+	if (hash_table == NULL)
+		name = "none";
+	else
+		name = ht_backing_name(hash_table);
+
+	mtx_unlock(&engine_mutex);
+
+	return name;
+}
+
+int
+engine_ht_save(const char *path)
+{
+	trace(__func__);
+
+	int result = -1;
+
+	mtx_lock(&engine_mutex);
+
+	stop_thinking();
+	if (hash_table != NULL)
+		result = ht_save(hash_table, path);
+
+	mtx_unlock(&engine_mutex);
+
+	return result;
+}
+
+int
+engine_ht_load(const char *path)
+{
+	trace(__func__);
+
+	struct hash_table *new_tt;
+
+	mtx_lock(&engine_mutex);
+
+	stop_thinking();
+	new_tt = ht_load(path);
+	if (new_tt != NULL) {
+		ht_destroy(hash_table);
+		hash_table = new_tt;
+	}
+
+	mtx_unlock(&engine_mutex);
+
+	return (new_tt != NULL) ? 0 : -1;
+}
+
 void
 reset_engine(const struct position *pos)
 {
@@ -801,13 +1006,12 @@ reset_engine(const struct position *pos)
 	mtx_lock(&engine_mutex);
 
 	stop_thinking();
-	for (unsigned i = 0; i < thread_count; ++i) {
-		if (threads[i].sd.tt != NULL) {
-			ht_clear(threads[i].sd.tt);
-			continue;
-		}
-		threads[i].sd.tt = ht_create_mb(horse->hash_table_size_mb);
-		if (threads[i].sd.tt == NULL) {
+	if (hash_table != NULL) {
+		ht_clear(hash_table);
+	}
+	else {
+		hash_table = ht_create_mb(horse->hash_table_size_mb);
+		if (hash_table == NULL) {
 			fprintf(stderr,
 			    "Unable to allocate transposition "
 			    "table - with size %umb",
@@ -815,14 +1019,9 @@ reset_engine(const struct position *pos)
 			exit(EXIT_FAILURE);
 		}
 	}
-	for (size_t i = thread_count; i < MAX_THREAD_COUNT; ++i) {
-		if (threads[i].sd.tt != NULL) {
-			ht_destroy(threads[i].sd.tt);
-			threads[i].sd.tt = NULL;
-		}
-	}
-	history[0] = *pos;
-	history_length = 1;
+	current_position = *pos;
+	history_length = 0;
+	add_history_key(&current_position);
 	fill_best_move();
 
 	mtx_unlock(&engine_mutex);
@@ -835,19 +1034,17 @@ engine_conf_change(void)
 
 	mtx_lock(horse->mutex);
 	new_hash_size = horse->hash_table_size_mb;
+	ht_set_clear_thread_count(horse->thread_count);
 	mtx_unlock(horse->mutex);
 
-	for (unsigned i = 0; i < MAX_THREAD_COUNT; ++i) {
-		struct search_thread_data *thread = threads + i;
-		mtx_lock(&engine_mutex);
-		if (!thread->is_started_flag) {
-			struct hash_table *new_tt =
-			    ht_resize_mb(threads[0].sd.tt, new_hash_size);
-			if (new_tt != NULL)
-				thread->sd.tt = new_tt;
-		}
-		mtx_unlock(&engine_mutex);
+	mtx_lock(&engine_mutex);
+	if (!threads[0].is_started_flag) {
+		struct hash_table *new_tt =
+		    ht_resize_mb(hash_table, new_hash_size);
+		if (new_tt != NULL)
+			hash_table = new_tt;
 	}
+	mtx_unlock(&engine_mutex);
 }
 
 
@@ -860,6 +1057,7 @@ init_engine(const struct taltos_conf *h)
 	xmtx_init(&engine_mutex, mtx_plain | mtx_recursive);
 
 	horse = h;
+	ht_set_clear_thread_count(horse->thread_count);
 
 	position_read_fen(&pos, start_position_fen, NULL, NULL);
 	reset_engine(&pos);
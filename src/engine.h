@@ -74,6 +74,10 @@ void reset_engine(const struct position*);
 void engine_process_move(move);
 void debug_engine_set_player_to_move(enum player);
 size_t engine_ht_size(void);
+unsigned engine_ht_size_mb(void);
+const char *engine_ht_backing(void);
+int engine_ht_save(const char *path);
+int engine_ht_load(const char *path);
 void engine_conf_change(void);
 void set_exact_node_count(uintmax_t);
 
@@ -142,118 +142,6 @@ eval_basic_mobility(const struct position *pos)
 	return (value * (popcnt(pos->occupied) + 6)) / 20;
 }
 
-static int
-king_safety_side(uint64_t king_map, uint64_t pawns, uint64_t opp_pawns,
-		uint64_t half_open_files,
-		uint64_t rooks, uint64_t king_reach,
-		uint64_t opp_attacks, uint64_t opp_sattacks)
-{
-	int value = 0;
-
-	/*
-	 * Bonus for castled king to encourage castling,
-	 * or at least not losing castling rights.
-	 */
-	if (is_nonempty(king_map & (SQ_G1|SQ_H1))
-	    && is_empty(rooks & SQ_H1))
-		value += castled_king_value;
-	else if (is_nonempty(king_map & (SQ_A1|SQ_C1|SQ_B1))
-	    && is_empty(rooks & SQ_A1))
-		value += castled_king_value;
-
-	/* Count pawns around the king */
-	uint64_t p = king_reach & pawns;
-	value += (kings_pawn_value / 2) * popcnt(p & ~opp_attacks);
-
-	p = (king_reach | north_of(king_reach)) & pawn_attacks_player(pawns);
-	value += kings_pawn_value * popcnt(p);
-
-	/*
-	 * Penalty for squares around the king being attacked by
-	 * other player
-	 */
-	value += king_ring_sliding_attacked_value *
-	    popcnt(king_reach & opp_sattacks);
-
-	/* shield - up to three squares in front of the king */
-	uint64_t shield = north_of(king_map)
-	    | north_of(west_of(king_map & ~FILE_H))
-	    | north_of(east_of(king_map & ~FILE_A));
-
-	// Penalty for not having any pawn on a file around the king
-	value += king_open_file_value * popcnt(shield & half_open_files);
-
-	// More Penalty for the king itself residing on an open file
-	if (is_nonempty(king_map & half_open_files))
-		value += king_open_file_value;
-
-	// Penalty for opponent pawns advancing towards the king
-	uint64_t storm = kogge_stone_north(shield) & opp_pawns;
-	storm &= RANK_2 | RANK_3 | RANK_4 | RANK_5;
-	value += king_pawn_storm_value * popcnt(storm);
-	value += king_pawn_storm_value * popcnt(storm & ~RANK_5);
-	value += king_pawn_storm_value * popcnt(storm & opp_sattacks & ~RANK_5);
-	value += king_pawn_storm_value * popcnt(storm & north_of(shield));
-
-	return value;
-}
-
-static int
-king_safety_wrapper(const struct position *pos)
-{
-	if (is_empty(pos->map[king] & (RANK_1|RANK_2)))
-		return -50;
-
-	return king_safety_side(pos->map[king],
-	    pos->map[pawn],
-	    pos->map[opponent_pawn],
-	    pos->half_open_files[0],
-	    pos->map[rook],
-	    pos->attack[king],
-	    pos->attack[1],
-	    pos->sliding_attacks[1]);
-}
-
-static int
-opponent_king_safety_wrapper(const struct position *pos)
-{
-	if (is_empty(pos->map[opponent_king] & (RANK_8|RANK_7)))
-		return -50;
-
-	return king_safety_side(bswap(pos->map[opponent_king]),
-	    bswap(pos->map[opponent_pawn]),
-	    bswap(pos->map[pawn]),
-	    bswap(pos->half_open_files[1]),
-	    bswap(pos->map[opponent_rook]),
-	    bswap(pos->attack[opponent_king]),
-	    bswap(pos->attack[0]),
-	    bswap(pos->sliding_attacks[0]));
-}
-
-static int
-eval_king_safety(const struct position *pos)
-{
-	int value = 0;
-
-	if (opponent_non_pawn_material(pos) > king_safety_treshold)
-		value += (king_safety_wrapper(pos)
-		    * opponent_non_pawn_material(pos))
-		    / (30 * pawn_value);
-
-	if (non_pawn_material(pos) > king_safety_treshold)
-		value -= (opponent_king_safety_wrapper(pos)
-		    * non_pawn_material(pos))
-		    / (30 * pawn_value);
-
-	if (pos->cr_king_side || pos->cr_queen_side)
-		value += castle_right_value;
-
-	if (pos->cr_opponent_king_side || pos->cr_opponent_queen_side)
-		value -= castle_right_value;
-
-	return value;
-}
-
 static int
 eval_center_control(const struct position *pos)
 {
@@ -316,8 +204,6 @@ eval_pawn_structure(const struct position *pos)
 
 	value += isolated_pawn_value * filecnt(isolated_pawns(pos));
 	value -= isolated_pawn_value * filecnt(opponent_isolated_pawns(pos));
-	value += blocked_pawn_value * filecnt(blocked_pawns(pos));
-	value -= blocked_pawn_value * filecnt(opponent_blocked_pawns(pos));
 	value += double_pawn_value * popcnt(double_pawns(pos));
 	value -= double_pawn_value * popcnt(opponent_double_pawns(pos));
 	value += backward_pawn_value * filecnt(backward_pawns(pos));
@@ -326,6 +212,17 @@ eval_pawn_structure(const struct position *pos)
 	return value;
 }
 
+static int
+eval_blocked_pawns(const struct position *pos)
+{
+	int value = 0;
+
+	value += blocked_pawn_value * filecnt(blocked_pawns(pos));
+	value -= blocked_pawn_value * filecnt(opponent_blocked_pawns(pos));
+
+	return value;
+}
+
 static int
 eval_knight_placement(const struct position *pos)
 {
@@ -440,6 +337,240 @@ eval_passed_pawns(const struct position *pos)
 	return value;
 }
 
+/*
+ * The pawn structure cache.
+ * The terms computed in eval_pawn_structure and eval_passed_pawns only
+ * depend on the placement of pawns, which rarely changes during search.
+ * The pawn shelter of the kings also depends on the squares of the
+ * kings, these are stored along with the squares they belong to.
+ * These values are cached per thread, indexed by the pawn hash key of
+ * the position - no locking is needed, and each search thread has its
+ * own cache, sized to fit in L2 cache.
+ * A position without any pawns has a zero key, which conveniently
+ * matches the initial all zero entries, with zero values.
+ */
+
+#ifndef PAWN_CACHE_SIZE_LOG2
+#define PAWN_CACHE_SIZE_LOG2 13
+#endif
+
+struct pawn_cache_entry {
+	uint64_t key;
+	int32_t structure;
+	int32_t passed;
+
+	/*
+	 * The shelter of each king, and the square of the king it was
+	 * computed for, plus one - zero when not computed yet.
+	 */
+	int16_t shelter[2];
+	uint8_t shelter_king_square[2];
+};
+
+static _Thread_local struct pawn_cache_entry
+pawn_cache[1u << PAWN_CACHE_SIZE_LOG2];
+
+static _Thread_local struct pawn_cache_stats pawn_cache_counters;
+
+static struct pawn_cache_entry*
+pawn_cache_lookup(const struct position *pos)
+{
+	uint64_t key = pos->pawn_zhash[0];
+	struct pawn_cache_entry *entry =
+	    pawn_cache + (key & ((1u << PAWN_CACHE_SIZE_LOG2) - 1));
+
+	pawn_cache_counters.probes++;
+	if (entry->key == key) {
+		pawn_cache_counters.hits++;
+		return entry;
+	}
+
+	entry->key = key;
+	entry->structure = eval_pawn_structure(pos);
+	entry->passed = eval_passed_pawns(pos);
+	entry->shelter_king_square[0] = 0;
+	entry->shelter_king_square[1] = 0;
+
+	return entry;
+}
+
+/*
+ * Up to three squares in front of the king.
+ */
+static uint64_t
+king_shield(uint64_t king_map)
+{
+	return north_of(king_map)
+	    | north_of(west_of(king_map & ~FILE_H))
+	    | north_of(east_of(king_map & ~FILE_A));
+}
+
+/*
+ * The terms of king safety depending only on the pawns, and the
+ * placement of the king: the open files around the king, and the
+ * opponent's pawns advancing towards it.
+ */
+static int
+king_shelter(uint64_t king_map, uint64_t opp_pawns, uint64_t half_open_files)
+{
+	int value = 0;
+	uint64_t shield = king_shield(king_map);
+
+	// Penalty for not having any pawn on a file around the king
+	value += king_open_file_value * popcnt(shield & half_open_files);
+
+	// More Penalty for the king itself residing on an open file
+	if (is_nonempty(king_map & half_open_files))
+		value += king_open_file_value;
+
+	// Penalty for opponent pawns advancing towards the king
+	uint64_t storm = kogge_stone_north(shield) & opp_pawns;
+	storm &= RANK_2 | RANK_3 | RANK_4 | RANK_5;
+	value += king_pawn_storm_value * popcnt(storm);
+	value += king_pawn_storm_value * popcnt(storm & ~RANK_5);
+	value += king_pawn_storm_value * popcnt(storm & north_of(shield));
+
+	return value;
+}
+
+static int
+king_safety_side(uint64_t king_map, uint64_t pawns, uint64_t opp_pawns,
+		int shelter,
+		uint64_t rooks, uint64_t king_reach,
+		uint64_t opp_attacks, uint64_t opp_sattacks)
+{
+	int value = shelter;
+
+	/*
+	 * Bonus for castled king to encourage castling,
+	 * or at least not losing castling rights.
+	 */
+	if (is_nonempty(king_map & (SQ_G1|SQ_H1))
+	    && is_empty(rooks & SQ_H1))
+		value += castled_king_value;
+	else if (is_nonempty(king_map & (SQ_A1|SQ_C1|SQ_B1))
+	    && is_empty(rooks & SQ_A1))
+		value += castled_king_value;
+
+	/* Count pawns around the king */
+	uint64_t p = king_reach & pawns;
+	value += (kings_pawn_value / 2) * popcnt(p & ~opp_attacks);
+
+	p = (king_reach | north_of(king_reach)) & pawn_attacks_player(pawns);
+	value += kings_pawn_value * popcnt(p);
+
+	/*
+	 * Penalty for squares around the king being attacked by
+	 * other player
+	 */
+	value += king_ring_sliding_attacked_value *
+	    popcnt(king_reach & opp_sattacks);
+
+	/*
+	 * More penalty for the storming pawns below the fifth rank, that
+	 * are defended by the opponent's sliding pieces. The king is on one
+	 * of the first two ranks, these are at most three ranks away from
+	 * the shield.
+	 */
+	uint64_t shield = king_shield(king_map);
+	uint64_t storm = shield | north_of(shield) | north_of(north_of(shield));
+	storm &= opp_pawns & (RANK_2 | RANK_3 | RANK_4);
+	value += king_pawn_storm_value * popcnt(storm & opp_sattacks);
+
+	return value;
+}
+
+/*
+ * The shelter of a king is computed when the pawn structure is seen with
+ * the king on a new square, and looked up in the pawn cache entry while
+ * the king stays on the same square.
+ */
+static int
+cached_king_shelter(struct pawn_cache_entry *entry, int side,
+		uint64_t king_map, uint64_t opp_pawns,
+		uint64_t half_open_files)
+{
+	uint8_t square = (uint8_t)(bsf(king_map) + 1);
+
+	if (entry->shelter_king_square[side] != square) {
+		entry->shelter[side] = (int16_t)king_shelter(king_map,
+		    opp_pawns, half_open_files);
+		entry->shelter_king_square[side] = square;
+	}
+
+	return entry->shelter[side];
+}
+
+static int
+king_safety_wrapper(const struct position *pos,
+		struct pawn_cache_entry *entry)
+{
+	if (is_empty(pos->map[king] & (RANK_1|RANK_2)))
+		return -50;
+
+	return king_safety_side(pos->map[king],
+	    pos->map[pawn],
+	    pos->map[opponent_pawn],
+	    cached_king_shelter(entry, 0,
+		pos->map[king],
+		pos->map[opponent_pawn],
+		pos->half_open_files[0]),
+	    pos->map[rook],
+	    pos->attack[king],
+	    pos->attack[1],
+	    pos->sliding_attacks[1]);
+}
+
+static int
+opponent_king_safety_wrapper(const struct position *pos,
+		struct pawn_cache_entry *entry)
+{
+	if (is_empty(pos->map[opponent_king] & (RANK_8|RANK_7)))
+		return -50;
+
+	return king_safety_side(bswap(pos->map[opponent_king]),
+	    bswap(pos->map[opponent_pawn]),
+	    bswap(pos->map[pawn]),
+	    cached_king_shelter(entry, 1,
+		bswap(pos->map[opponent_king]),
+		bswap(pos->map[pawn]),
+		bswap(pos->half_open_files[1])),
+	    bswap(pos->map[opponent_rook]),
+	    bswap(pos->attack[opponent_king]),
+	    bswap(pos->attack[0]),
+	    bswap(pos->sliding_attacks[0]));
+}
+
+static int
+eval_king_safety(const struct position *pos, struct pawn_cache_entry *entry)
+{
+	int value = 0;
+
+	if (opponent_non_pawn_material(pos) > king_safety_treshold)
+		value += (king_safety_wrapper(pos, entry)
+		    * opponent_non_pawn_material(pos))
+		    / (30 * pawn_value);
+
+	if (non_pawn_material(pos) > king_safety_treshold)
+		value -= (opponent_king_safety_wrapper(pos, entry)
+		    * non_pawn_material(pos))
+		    / (30 * pawn_value);
+
+	if (pos->cr_king_side || pos->cr_queen_side)
+		value += castle_right_value;
+
+	if (pos->cr_opponent_king_side || pos->cr_opponent_queen_side)
+		value -= castle_right_value;
+
+	return value;
+}
+
+struct pawn_cache_stats
+eval_pawn_cache_stats(void)
+{
+	return pawn_cache_counters;
+}
+
 int
 eval_threats(const struct position *pos)
 {
@@ -481,17 +612,23 @@ eval(const struct position *pos)
 {
 	int value = 0;
 
+	assert(position_is_complete(pos));
+
 	value += pos->material_value;
 	value -= pos->opponent_material_value;
 	value += eval_basic_mobility(pos);
-	value += eval_passed_pawns(pos);
-	value += eval_pawn_structure(pos);
+	value += eval_blocked_pawns(pos);
+
+	struct pawn_cache_entry *pawn_entry = pawn_cache_lookup(pos);
+	value += pawn_entry->structure;
+	value += pawn_entry->passed;
+
 	value += eval_knight_placement(pos);
 	value += eval_threats(pos);
 	if (is_nonempty(pos->sliding_attacks[0] | pos->sliding_attacks[1])) {
 		value += eval_rook_placement(pos);
 		value += eval_bishop_placement(pos);
-		value += eval_king_safety(pos);
+		value += eval_king_safety(pos, pawn_entry);
 		value += eval_center_control(pos);
 	}
 
@@ -509,9 +646,9 @@ compute_eval_factors(const struct position *pos)
 	ef.material = pos->material_value - pos->opponent_material_value;
 	ef.basic_mobility = eval_basic_mobility(pos);
 	ef.center_control = eval_center_control(pos);
-	ef.pawn_structure = eval_pawn_structure(pos);
+	ef.pawn_structure = eval_pawn_structure(pos) + eval_blocked_pawns(pos);
 	ef.passed_pawns = eval_passed_pawns(pos);
-	ef.king_safety = eval_king_safety(pos);
+	ef.king_safety = eval_king_safety(pos, pawn_cache_lookup(pos));
 	ef.rook_placement = eval_rook_placement(pos);
 	ef.knight_placement = eval_knight_placement(pos);
 	ef.bishop_placement = eval_bishop_placement(pos);
@@ -81,6 +81,14 @@ struct eval_factors {
 int eval_threats(const struct position *pos)
 	attribute(nonnull);
 
+struct pawn_cache_stats {
+	uintmax_t probes;
+	uintmax_t hits;
+};
+
+// Counters of the pawn structure cache used by the calling thread
+struct pawn_cache_stats eval_pawn_cache_stats(void);
+
 struct eval_factors compute_eval_factors(const struct position*)
 	attribute(nonnull);
 
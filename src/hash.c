@@ -25,9 +25,11 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
 #include "macros.h"
 
@@ -44,23 +46,50 @@
 #endif
 
 #ifndef HT_MAX_SIZE
-#define HT_MAX_SIZE 26
+#define HT_MAX_SIZE 32
 #endif
 
 
-/*
- * The bits in the lower 32 bits, not used for storing the move,
- * or the value_type.
- */
-#define COUNTER_MASK \
-	((uint64_t)((uint32_t)~(MOVE_MASK | VALUE_TYPE_MASK | HT_NO_NULL_FLAG)))
-
 static_assert((MOVE_MASK & VALUE_TYPE_MASK) == 0, "layout");
 static_assert((MOVE_MASK & HT_NO_NULL_FLAG) == 0, "layout");
 static_assert((VALUE_TYPE_MASK & HT_NO_NULL_FLAG) == 0, "layout");
 
-#define HASH_MASK (~COUNTER_MASK)
+/*
+ * The search generation an entry was stored in, kept in the bits not
+ * used by anything else in an entry. The generation is incremented at the
+ * start of each search, and entries left over from previous searches are
+ * preferred for replacement over entries written during the current search.
+ * The generation is stripped from entries returned by lookups.
+ */
+#define GENERATION_SHIFT 26
+#define GENERATION_COUNT 32
+#define GENERATION_MASK \
+	(((uint64_t)GENERATION_COUNT - 1) << GENERATION_SHIFT)
+
+static_assert((GENERATION_MASK & MOVE_MASK) == 0, "layout");
+static_assert((GENERATION_MASK & VALUE_TYPE_MASK) == 0, "layout");
+static_assert((GENERATION_MASK & HT_NO_NULL_FLAG) == 0, "layout");
+static_assert((GENERATION_MASK & (UINT64_C(0xffffffff) << 32)) == 0,
+		"layout");
+
+/*
+ * When choosing a deep slot to replace, the age of an entry counts
+ * as much as this much depth per each generation.
+ */
+#define GENERATION_DEPTH_WEIGHT (4 * PLY)
 
+/*
+ * The slots are read and written by multiple search threads without any
+ * locking. A slot is written using two separate stores, thus another
+ * thread might read a slot while it is half way overwritten, i.e. read
+ * the hash_key of one entry, and the entry field of another one.
+ * To detect such torn reads, the hash_key field does not contain the
+ * hash key itself, but the hash key XOR-ed with the entry. A slot read
+ * is only accepted, if XOR-ing its two fields results in the hash key
+ * being looked up - which is not the case in a torn slot, barring
+ * a hash collision.
+ * An empty slot has both fields set to zero.
+ */
 struct slot {
 	alignas(16) uint64_t hash_key;
 	uint64_t entry;
@@ -95,10 +124,10 @@ struct bucket {
 };
 
 struct hash_table {
-	unsigned long bucket_count;
+	size_t bucket_count;
 	struct bucket *table;
-	unsigned long usage;
-	unsigned log2_size;
+	enum memory_backing backing;
+	unsigned generation;
 };
 
 size_t
@@ -108,15 +137,22 @@ ht_slot_count(const struct hash_table *ht)
 }
 
 size_t
-ht_usage(const struct hash_table *ht)
+ht_size(const struct hash_table *ht)
 {
-	return ht->usage;
+	return ht->bucket_count * sizeof(ht->table[0]);
 }
 
-size_t
-ht_size(const struct hash_table *ht)
+static const size_t buckets_per_mb = 1024 * 1024 / sizeof(struct bucket);
+
+static uintmax_t
+max_bucket_count(void)
 {
-	return ht->bucket_count * sizeof(ht->table[0]);
+	uintmax_t max = UINTMAX_C(1) << HT_MAX_SIZE;
+
+	if (max > SIZE_MAX / sizeof(struct bucket))
+		max = SIZE_MAX / sizeof(struct bucket);
+
+	return max;
 }
 
 unsigned
@@ -128,24 +164,48 @@ ht_min_size_mb(void)
 unsigned
 ht_max_size_mb(void)
 {
-	return (((size_t)1 << HT_MAX_SIZE) * sizeof(struct bucket))
-	    / (1024 * 1024);
+	uintmax_t max = max_bucket_count() / buckets_per_mb;
+
+	if (max > UINT_MAX)
+		max = UINT_MAX;
+
+	return (unsigned)max;
 }
 
-struct hash_table*
-ht_create(unsigned log2_size)
+unsigned
+ht_size_mb(const struct hash_table *ht)
 {
-	tracef("%s %u", __func__, log2_size);
+	uintmax_t mb = (ht->bucket_count + buckets_per_mb - 1) / buckets_per_mb;
+
+	if (mb < ht_min_size_mb())
+		mb = ht_min_size_mb();
+	else if (mb > ht_max_size_mb())
+		mb = ht_max_size_mb();
+
+	return (unsigned)mb;
+}
+
+static bool
+is_bucket_count_valid(uintmax_t bucket_count)
+{
+	return bucket_count >= (UINTMAX_C(1) << HT_MIN_SIZE)
+	    && bucket_count <= max_bucket_count();
+}
+
+static struct hash_table*
+create_table(size_t bucket_count)
+{
+	tracef("%s %zu", __func__, bucket_count);
 
 	struct hash_table *ht;
 
-	if (log2_size < HT_MIN_SIZE || log2_size > HT_MAX_SIZE)
+	if (!is_bucket_count_valid(bucket_count))
 		return NULL;
 
 	ht = xmalloc(sizeof *ht);
-	ht->bucket_count = (((size_t)1) << log2_size);
-	ht->log2_size = log2_size;
-	ht->table = aligned_alloc(alignof(struct bucket), ht_size(ht));
+	ht->bucket_count = bucket_count;
+	ht->generation = 0;
+	ht->table = large_alloc(ht_size(ht), &ht->backing);
 	if (ht->table == NULL) {
 		free(ht);
 		return NULL;
@@ -154,36 +214,22 @@ ht_create(unsigned log2_size)
 	return ht;
 }
 
-static unsigned
-get_log2_size(uintmax_t megabytes)
+struct hash_table*
+ht_create(unsigned log2_size)
 {
-	static const size_t multiplier = 1024 * 1024 / sizeof(struct bucket);
-
-	if (megabytes == 0)
-		return 0;
-
-	if ((megabytes & (megabytes - 1)) != 0)
-		return 0;
-
-	if (megabytes * multiplier < megabytes)
-		return 0;
-
-	megabytes *= multiplier;
-
-	unsigned result = 0;
+	tracef("%s %u", __func__, log2_size);
 
-	while (megabytes != (1u << result))
-		++result;
+	if (log2_size < HT_MIN_SIZE || log2_size > HT_MAX_SIZE)
+		return NULL;
 
-	return result;
+	return create_table(((size_t)1) << log2_size);
 }
 
 bool
 ht_is_mb_size_valid(unsigned megabytes)
 {
 	return megabytes >= ht_min_size_mb()
-	    && megabytes <= ht_max_size_mb()
-	    && get_log2_size(megabytes) != 0;
+	    && megabytes <= ht_max_size_mb();
 }
 
 struct hash_table*
@@ -191,44 +237,156 @@ ht_create_mb(unsigned megabytes)
 {
 	tracef("%s %umb", __func__, megabytes);
 
-	return ht_create(get_log2_size(megabytes));
+	if (!ht_is_mb_size_valid(megabytes))
+		return NULL;
+
+	return create_table(megabytes * buckets_per_mb);
 }
 
-struct hash_table*
-ht_resize(struct hash_table *ht, unsigned log2_size)
+static struct hash_table*
+resize_table(struct hash_table *ht, size_t bucket_count)
 {
-	tracef("%s %u", __func__, log2_size);
-
-	unsigned long bucket_count = (1lu << log2_size);
+	tracef("%s %zu", __func__, bucket_count);
 
 	if (ht == NULL)
-		return ht_create(log2_size);
+		return create_table(bucket_count);
 
-	if (ht->log2_size == log2_size)
+	if (ht->bucket_count == bucket_count)
 		return ht;
 
-	ht->log2_size = log2_size;
+	if (!is_bucket_count_valid(bucket_count))
+		return NULL;
 
 	struct bucket *table;
+	enum memory_backing backing;
 
-	table = aligned_alloc(alignof(struct bucket),
-	    bucket_count * sizeof(table[0]));
+	table = large_alloc(bucket_count * sizeof(table[0]), &backing);
 	if (table == NULL)
 		return NULL;
 
-	xaligned_free(ht->table);
+	large_free(ht->table, ht_size(ht), ht->backing);
 	ht->table = table;
+	ht->backing = backing;
 	ht->bucket_count = bucket_count;
 	ht_clear(ht);
 	return ht;
 }
 
+struct hash_table*
+ht_resize(struct hash_table *ht, unsigned log2_size)
+{
+	tracef("%s %u", __func__, log2_size);
+
+	if (log2_size < HT_MIN_SIZE || log2_size > HT_MAX_SIZE)
+		return NULL;
+
+	return resize_table(ht, ((size_t)1) << log2_size);
+}
+
 struct hash_table*
 ht_resize_mb(struct hash_table *ht, unsigned megabytes)
 {
 	tracef("%s %umb", __func__, megabytes);
 
-	return ht_resize(ht, get_log2_size(megabytes));
+	if (!ht_is_mb_size_valid(megabytes))
+		return NULL;
+
+	if (ht != NULL && ht_size_mb(ht) == megabytes)
+		return ht;
+
+	return resize_table(ht, megabytes * buckets_per_mb);
+}
+
+/*
+ * Map a 64 bit hash value to a bucket index in [0, bucket_count),
+ * by taking the upper 64 bits of the 128 bit product of the two.
+ * Unlike masking the hash value, this works with any bucket count, not
+ * just with powers of two, and costs only a single multiplication.
+ * See: Daniel Lemire - A fast alternative to the modulo reduction
+ */
+#ifdef TALTOS_CAN_USE_GNU_UINT128
+
+static size_t
+bucket_index(const struct hash_table *ht, uint64_t hash)
+{
+	__extension__ typedef unsigned __int128 uint128;
+
+	return (size_t)(((uint128)hash * ht->bucket_count) >> 64);
+}
+
+#else
+
+static size_t
+bucket_index(const struct hash_table *ht, uint64_t hash)
+{
+	uint64_t count = ht->bucket_count;
+	uint64_t lo_lo = (hash & 0xffffffff) * (count & 0xffffffff);
+	uint64_t hi_lo = (hash >> 32) * (count & 0xffffffff);
+	uint64_t lo_hi = (hash & 0xffffffff) * (count >> 32);
+	uint64_t hi_hi = (hash >> 32) * (count >> 32);
+	uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+
+	return (size_t)(hi_hi + (hi_lo >> 32) + (cross >> 32));
+}
+
+#endif
+
+static volatile struct bucket*
+get_bucket(const struct hash_table *ht, uint64_t hash)
+{
+	return ht->table + bucket_index(ht, hash);
+}
+
+/*
+ * The bucket index is derived from the high bits of the hash value,
+ * the fresh slot index from the lowest bits.
+ */
+static unsigned
+fresh_slot_index(uint64_t hash)
+{
+	return DEEP_SLOT_COUNT + (unsigned)(hash % FRESH_SLOT_COUNT);
+}
+
+/*
+ * Large tables are cleared by multiple threads, each one zeroing its own
+ * contiguous slice of the table. Besides finishing sooner, on NUMA systems
+ * this also means the pages of a newly allocated table are first touched
+ * by different threads, thus are spread over multiple nodes.
+ * Each thread gets a slice of at least clear_min_slice_size bytes.
+ */
+#ifndef HT_MAX_CLEAR_THREAD_COUNT
+#define HT_MAX_CLEAR_THREAD_COUNT 64
+#endif
+
+static const size_t clear_min_slice_size = 16 * 1024 * 1024;
+
+static unsigned clear_thread_count = 1;
+
+void
+ht_set_clear_thread_count(unsigned count)
+{
+	if (count < 1)
+		count = 1;
+	else if (count > HT_MAX_CLEAR_THREAD_COUNT)
+		count = HT_MAX_CLEAR_THREAD_COUNT;
+
+	clear_thread_count = count;
+}
+
+struct clear_slice {
+	thrd_t thr;
+	bool is_started;
+	void *address;
+	size_t size;
+};
+
+static int
+clear_slice(void *arg)
+{
+	struct clear_slice *slice = arg;
+
+	memset(slice->address, 0, slice->size);
+	return 0;
 }
 
 void
@@ -236,39 +394,303 @@ ht_clear(struct hash_table *ht)
 {
 	trace(__func__);
 
-	memset((void*)(ht->table), 0, ht_size(ht));
-	ht->usage = 0;
+	struct clear_slice slices[HT_MAX_CLEAR_THREAD_COUNT];
+	size_t count = clear_thread_count;
+
+	if (ht_size(ht) / clear_min_slice_size < count)
+		count = ht_size(ht) / clear_min_slice_size;
+	if (count < 1)
+		count = 1;
+
+	size_t buckets_per_slice = ht->bucket_count / count;
+
+	for (size_t i = 0; i < count; ++i) {
+		size_t first = i * buckets_per_slice;
+		size_t last = first + buckets_per_slice;
+		if (i == count - 1)
+			last = ht->bucket_count;
+
+		slices[i].address = (void*)(ht->table + first);
+		slices[i].size = (last - first) * sizeof(ht->table[0]);
+		slices[i].is_started = false;
+	}
+
+	// The first slice is cleared on the calling thread
+	for (size_t i = 1; i < count; ++i) {
+		slices[i].is_started =
+		    thrd_create(&slices[i].thr, clear_slice, slices + i)
+		    == thrd_success;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (slices[i].is_started)
+			thrd_join(slices[i].thr, NULL);
+		else
+			clear_slice(slices + i);
+	}
 }
 
 void
 ht_destroy(struct hash_table *ht)
 {
 	if (ht != NULL) {
-		xaligned_free((void*)ht->table);
+		large_free(ht->table, ht_size(ht), ht->backing);
 		free(ht);
 	}
 }
 
+const char*
+ht_backing_name(const struct hash_table *ht)
+{
+	return memory_backing_name(ht->backing);
+}
+
+/*
+ * The file format used by ht_save and ht_load: a header describing the
+ * table, padded to HT_FILE_HEADER_SIZE bytes, followed by the buckets
+ * as they are in memory. The padding allows memory mapping the buckets
+ * directly from the file, as the offset of a mapping must be page aligned.
+ * The header is written in native byte order, files written on a platform
+ * with different endianness are rejected, based on the byte_order field.
+ * The key_check field is the hash key of the starting position, protecting
+ * against loading a table built using different zobrist keys.
+ */
+#define HT_FILE_HEADER_SIZE 4096
+#define HT_FILE_VERSION 1
+
+static const char ht_file_magic[8] = "TaltosHT";
+
+struct ht_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t slot_size;
+	uint32_t fresh_slot_count;
+	uint32_t deep_slot_count;
+	uint32_t generation;
+	uint64_t bucket_count;
+	uint64_t usage;
+	uint64_t key_check;
+};
+
+static_assert(sizeof(struct ht_file_header) <= HT_FILE_HEADER_SIZE,
+	"hash table file header too large");
+
+static_assert(HT_FILE_HEADER_SIZE % alignof(struct bucket) == 0,
+	"hash table file header size misaligns buckets");
+
+static uint64_t
+zobrist_key_check(void)
+{
+	struct position pos;
+
+	if (position_read_fen(&pos, start_position_fen, NULL, NULL) == NULL)
+		return 0;
+
+	return pos.zhash[0];
+}
+
+static void
+setup_file_header(const struct hash_table *ht, struct ht_file_header *header)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, ht_file_magic, sizeof(header->magic));
+	header->version = HT_FILE_VERSION;
+	header->byte_order = 0x01020304;
+	header->slot_size = sizeof(struct slot);
+	header->fresh_slot_count = FRESH_SLOT_COUNT;
+	header->deep_slot_count = DEEP_SLOT_COUNT;
+	header->key_check = zobrist_key_check();
+	if (ht != NULL) {
+		header->generation = ht->generation;
+		header->bucket_count = ht->bucket_count;
+		header->usage = ht_usage(ht);
+	}
+}
+
+static bool
+is_file_header_compatible(const struct ht_file_header *header)
+{
+	struct ht_file_header expected;
+
+	setup_file_header(NULL, &expected);
+
+	return memcmp(header->magic, expected.magic, sizeof(header->magic)) == 0
+	    && header->version == expected.version
+	    && header->byte_order == expected.byte_order
+	    && header->slot_size == expected.slot_size
+	    && header->fresh_slot_count == expected.fresh_slot_count
+	    && header->deep_slot_count == expected.deep_slot_count
+	    && header->key_check == expected.key_check
+	    && header->generation < GENERATION_COUNT
+	    && is_bucket_count_valid(header->bucket_count);
+}
+
+int
+ht_save(const struct hash_table *ht, const char *path)
+{
+	tracef("%s %s", __func__, path);
+
+	static unsigned char buffer[HT_FILE_HEADER_SIZE];
+	struct ht_file_header header;
+	FILE *file;
+	int result = 0;
+
+	if ((file = fopen(path, "wb")) == NULL)
+		return -1;
+
+	setup_file_header(ht, &header);
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(buffer, &header, sizeof(header));
+
+	if (fwrite(buffer, sizeof(buffer), 1, file) != 1)
+		result = -1;
+	else if (fwrite((const void*)ht->table, ht_size(ht), 1, file) != 1)
+		result = -1;
+
+	if (fclose(file) != 0)
+		result = -1;
+
+	return result;
+}
+
+/*
+ * Reading the whole table into memory, used when it can't be mapped.
+ */
+static struct bucket*
+read_table(FILE *file, size_t size, enum memory_backing *backing)
+{
+	struct bucket *table;
+
+	if (fseek(file, HT_FILE_HEADER_SIZE, SEEK_SET) != 0)
+		return NULL;
+
+	if ((table = large_alloc(size, backing)) == NULL)
+		return NULL;
+
+	if (fread(table, size, 1, file) != 1) {
+		large_free(table, size, *backing);
+		return NULL;
+	}
+
+	return table;
+}
+
+struct hash_table*
+ht_load(const char *path)
+{
+	tracef("%s %s", __func__, path);
+
+	struct ht_file_header header;
+	struct hash_table *ht;
+	FILE *file;
+	size_t file_size;
+
+	if ((file = fopen(path, "rb")) == NULL)
+		return NULL;
+
+	if (fread(&header, sizeof(header), 1, file) != 1
+	    || !is_file_header_compatible(&header)) {
+		fclose(file);
+		return NULL;
+	}
+
+	ht = xmalloc(sizeof *ht);
+	ht->bucket_count = (size_t)header.bucket_count;
+	ht->generation = header.generation;
+
+	if (bin_file_size(file, &file_size) != 0
+	    || file_size != HT_FILE_HEADER_SIZE + ht_size(ht)) {
+		fclose(file);
+		free(ht);
+		return NULL;
+	}
+
+	ht->table = large_map_file(file, HT_FILE_HEADER_SIZE, ht_size(ht),
+	    &ht->backing);
+
+	if (ht->table == NULL)
+		ht->table = read_table(file, ht_size(ht), &ht->backing);
+
+	fclose(file);
+
+	if (ht->table == NULL) {
+		free(ht);
+		return NULL;
+	}
+
+	return ht;
+}
+
 #ifdef TALTOS_CAN_USE_BUILTIN_PREFETCH
 void
 ht_prefetch(const struct hash_table *ht, uint64_t hash)
 {
-	prefetch(ht->table + (hash & (ht->bucket_count - 1)));
+	prefetch((const void*)get_bucket(ht, hash));
 }
 #endif
 
 static bool
-hash_match(const struct slot *slot, const uint64_t hash[static 2])
+is_slot_empty(const struct slot *slot)
 {
-	return ((slot->hash_key ^ hash[1]) & HASH_MASK) == 0;
+	return !ht_is_set(slot->entry);
+}
+
+enum { usage_sample_bucket_count = 1024 };
+
+/*
+ * The number of deep slots in use. Counting them upon insertion would
+ * need a counter shared by all search threads, so they are counted here
+ * instead - in large tables only in the first few buckets, which is
+ * enough for an estimate, as the entries are spread evenly among all
+ * buckets.
+ */
+size_t
+ht_usage(const struct hash_table *ht)
+{
+	size_t sample_count = ht->bucket_count;
+	uintmax_t usage = 0;
+
+	if (sample_count > usage_sample_bucket_count)
+		sample_count = usage_sample_bucket_count;
+
+	for (size_t i = 0; i < sample_count; ++i) {
+		for (unsigned j = 0; j < DEEP_SLOT_COUNT; ++j) {
+			struct slot slot = ht->table[i].slots[j];
+			if (!is_slot_empty(&slot))
+				++usage;
+		}
+	}
+
+	return (size_t)(usage * ht->bucket_count / sample_count);
 }
 
 static bool
-thread_id_match(const struct slot *slot)
+hash_match(const struct slot *slot, const uint64_t hash[static 2])
 {
-	(void) slot;
-	return true;
-	// todo: return ((slot->hash_key ^ slot->entry) & COUNTER_MASK) == 0;
+	return !is_slot_empty(slot)
+	    && (slot->hash_key ^ slot->entry) == hash[1];
+}
+
+static ht_entry
+slot_entry(const struct slot *slot)
+{
+	return slot->entry & ~GENERATION_MASK;
+}
+
+static unsigned
+slot_generation(const struct slot *slot)
+{
+	return (unsigned)((slot->entry & GENERATION_MASK) >> GENERATION_SHIFT);
+}
+
+/*
+ * How many searches ago was the slot written.
+ */
+static unsigned
+slot_age(const struct hash_table *ht, const struct slot *slot)
+{
+	return (ht->generation - slot_generation(slot)) % GENERATION_COUNT;
 }
 
 static bool
@@ -290,18 +712,11 @@ ht_entry
 ht_lookup_fresh(const struct hash_table *ht,
 		const struct position *pos)
 {
-	volatile struct bucket *bucket =
-	    ht->table + (pos->zhash[0] & (ht->bucket_count - 1));
+	volatile struct bucket *bucket = get_bucket(ht, pos->zhash[0]);
+	struct slot slot = bucket->slots[fresh_slot_index(pos->zhash[0])];
 
-	unsigned index = DEEP_SLOT_COUNT;
-	index += ((pos->zhash[0] >> ht->log2_size) % FRESH_SLOT_COUNT);
-
-	struct slot slot = bucket->slots[index];
-
-	if (thread_id_match(&slot)
-	    && hash_match(&slot, pos->zhash)
-	    && move_ok(slot.entry, pos))
-		return slot.entry;
+	if (hash_match(&slot, pos->zhash) && move_ok(slot.entry, pos))
+		return slot_entry(&slot);
 	return 0;
 }
 
@@ -312,48 +727,38 @@ ht_lookup_deep(const struct hash_table *ht,
 		int beta)
 {
 	ht_entry best = 0;
-	volatile struct bucket *bucket =
-	    ht->table + (pos->zhash[0] & (ht->bucket_count - 1));
+	volatile struct bucket *bucket = get_bucket(ht, pos->zhash[0]);
 
 	for (size_t i = 0; i < DEEP_SLOT_COUNT; ++i) {
 		struct slot slot = bucket->slots[i];
-		if (thread_id_match(&slot)
-		    && hash_match(&slot, pos->zhash)
+		if (hash_match(&slot, pos->zhash)
 		    && move_ok(slot.entry, pos)) {
-			if (ht_depth(slot.entry) >= depth) {
-				if (ht_value_type(slot.entry) == vt_exact)
-					return slot.entry;
-				if (ht_value_type(slot.entry) == vt_lower_bound
-				    && ht_value(slot.entry) >= beta)
-					return slot.entry;
+			ht_entry entry = slot_entry(&slot);
+			if (ht_depth(entry) >= depth) {
+				if (ht_value_type(entry) == vt_exact)
+					return entry;
+				if (ht_value_type(entry) == vt_lower_bound
+				    && ht_value(entry) >= beta)
+					return entry;
 			}
-			if (ht_depth(slot.entry) >= ht_depth(best)) {
-				best = slot.entry;
+			if (ht_depth(entry) >= ht_depth(best)) {
+				best = entry;
 			}
 		}
 	}
 	return best;
 }
 
-/*
- * todo:
- * static uint64_t
- * increment_counter(uint64_t counter)
- * {
- * return (counter - COUNTER_MASK) & COUNTER_MASK;
- * }
- */
-
 static void
-overwrite_slot(volatile struct slot *dst,
+overwrite_slot(const struct hash_table *ht,
+		volatile struct slot *dst,
 		const uint64_t hash[static 2],
 		ht_entry entry)
 {
-	// todo:
-	// uint64_t counter = increment_counter(dst->hash_key & COUNTER_MASK);
-	uint64_t counter = 0;
-	dst->hash_key = (hash[1] & HASH_MASK) | counter;
-	dst->entry = entry | counter;
+	entry &= ~GENERATION_MASK;
+	entry |= ((uint64_t)ht->generation) << GENERATION_SHIFT;
+	dst->hash_key = hash[1] ^ entry;
+	dst->entry = entry;
 }
 
 static void
@@ -362,10 +767,23 @@ write_fresh_slot(struct hash_table *ht,
 		const uint64_t hash[static 2],
 		ht_entry entry)
 {
-	unsigned index = DEEP_SLOT_COUNT;
-	index += ((hash[0] >> ht->log2_size) % FRESH_SLOT_COUNT);
+	overwrite_slot(ht, bucket->slots + fresh_slot_index(hash[0]),
+	    hash, entry);
+}
+
+/*
+ * The value of keeping the entry in a slot, the slot with the lowest
+ * value is replaced first: empty slots first, then shallow entries, while
+ * entries from older searches lose some of their value with each generation.
+ */
+static int
+slot_keep_value(const struct hash_table *ht, const struct slot *slot)
+{
+	if (is_slot_empty(slot))
+		return INT_MIN;
 
-	overwrite_slot(bucket->slots + index, hash, entry);
+	return ht_depth(slot->entry)
+	    - (int)slot_age(ht, slot) * GENERATION_DEPTH_WEIGHT;
 }
 
 void
@@ -379,33 +797,36 @@ ht_pos_insert(struct hash_table *ht,
 		return;
 
 	hash = pos->zhash;
-	bucket = ht->table + (hash[0] & (ht->bucket_count - 1));
+	bucket = get_bucket(ht, hash[0]);
 
 	write_fresh_slot(ht, bucket, hash, entry);
 
-	unsigned depth_min_index = 0;
-	int depth_min = 0x10000;
+	unsigned victim = 0;
+	int victim_value = INT_MAX;
 
-	for (unsigned i = 0; i < DEEP_SLOT_COUNT / 2; ++i) {
+	for (unsigned i = 0; i < DEEP_SLOT_COUNT; ++i) {
 		struct slot tslot = bucket->slots[i];
 		if (hash_match(&tslot, hash)
 		    && move_ok(tslot.entry, pos)
 		    && (ht_value_type(tslot.entry) == ht_value_type(entry))) {
-			if (ht_depth(tslot.entry) <= ht_depth(entry))
-				overwrite_slot(bucket->slots + i, hash, entry);
+			if (ht_depth(tslot.entry) <= ht_depth(entry)
+			    || slot_age(ht, &tslot) != 0)
+				overwrite_slot(ht, bucket->slots + i, hash, entry);
 			return;
 		}
-		if (ht_depth(tslot.entry) < depth_min) {
-			depth_min = ht_depth(tslot.entry);
-			depth_min_index = i;
+		int value = slot_keep_value(ht, &tslot);
+		if (value < victim_value) {
+			victim_value = value;
+			victim = i;
 		}
 	}
-	if (depth_min < ht_depth(entry)) {
-		if (bucket->slots[depth_min_index].hash_key == 0)
-			ht->usage++;
 
-		overwrite_slot(bucket->slots + depth_min_index, hash, entry);
-	}
+	struct slot vslot = bucket->slots[victim];
+
+	if (is_slot_empty(&vslot)
+	    || slot_age(ht, &vslot) != 0
+	    || ht_depth(vslot.entry) < ht_depth(entry))
+		overwrite_slot(ht, bucket->slots + victim, hash, entry);
 }
 
 void
@@ -440,27 +861,10 @@ ht_extract_pv(const struct hash_table *ht,
 	ht_extract_pv(ht, child, depth - PLY, pv + 1, -value);
 }
 
-static void
-slot_swap(struct hash_table *ht, volatile struct slot *slot)
-{
-	if (slot->hash_key != 0) {
-		slot[DEEP_SLOT_COUNT / 2] = *slot;
-		if (ht_depth(slot->entry) < 99) {
-			ht->usage--;
-			slot->hash_key = 0;
-			slot->entry = 0;
-		}
-	}
-}
-
 void
-ht_swap(struct hash_table *ht)
+ht_next_generation(struct hash_table *ht)
 {
 	trace(__func__);
 
-	for (unsigned i = 0; i != ht->bucket_count; ++i) {
-		volatile struct bucket *bucket = ht->table + i;
-		for (unsigned si = 0; si < DEEP_SLOT_COUNT / 2; ++si)
-			slot_swap(ht, bucket->slots + si);
-	}
+	ht->generation = (ht->generation + 1) % GENERATION_COUNT;
 }
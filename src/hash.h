@@ -55,7 +55,7 @@ static_assert(move_bit_mask_plus_one_shift <= 24, "layout requirement");
  *
  * best move    : bits  0 - 23
  * value type   : bits 24 - 25
- * reserved     : bits 26 - 30
+ * generation   : bits 26 - 30 ( only used inside hash.c )
  * no_null      : bits 31 - 31
  * value        : bits 32 - 47
  * depth        : bits 48 - 63
@@ -318,6 +318,11 @@ struct hash_table *ht_create_mb(unsigned megabytes);
 
 struct hash_table *ht_resize(struct hash_table*, unsigned log2_size);
 
+/*
+ * A table already of the requested size according to ht_size_mb is left
+ * intact, even if its size is not an exact multiple of a megabyte, as is
+ * the case with some tables created by ht_create or ht_load.
+ */
 struct hash_table *ht_resize_mb(struct hash_table*, unsigned megabytes);
 
 void ht_destroy(struct hash_table*);
@@ -349,16 +354,44 @@ void ht_extract_pv(const struct hash_table*, const struct position*,
 size_t ht_size(const struct hash_table*)
 	attribute(nonnull);
 
+const char *ht_backing_name(const struct hash_table*)
+	attribute(nonnull, returns_nonnull);
+
+/*
+ * Write the table to a binary file, that can be loaded later using ht_load.
+ * Returns non-zero on failure.
+ */
+int ht_save(const struct hash_table*, const char *path)
+	attribute(nonnull, warn_unused_result);
+
+/*
+ * Create a table from a file written by ht_save. Where the platform allows,
+ * the file is memory mapped instead of being read at once.
+ * Returns NULL if the file can not be read, or was written by
+ * an incompatible build.
+ */
+struct hash_table *ht_load(const char *path)
+	attribute(nonnull, warn_unused_result);
+
 bool ht_is_mb_size_valid(unsigned megabytes);
 
 unsigned ht_min_size_mb(void);
 
 unsigned ht_max_size_mb(void);
 
+/*
+ * The size of the table in megabytes, rounded up, and clamped to the range
+ * of valid sizes.
+ */
+unsigned ht_size_mb(const struct hash_table*)
+	attribute(nonnull);
+
 void ht_clear(struct hash_table*)
 	attribute(nonnull);
 
-void ht_swap(struct hash_table*)
+void ht_set_clear_thread_count(unsigned);
+
+void ht_next_generation(struct hash_table*)
 	attribute(nonnull);
 
 size_t ht_usage(const struct hash_table*)
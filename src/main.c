@@ -25,6 +25,7 @@
  */
 
 #include <errno.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <signal.h>
 #include <string.h>
@@ -69,6 +70,7 @@ main(int argc, char **argv)
 	setup_defaults();
 	trace_init(argv);
 	init_zhash_table();
+	init_slider_attacks();
 	init_search();
 	process_args(argv);
 	init_book(&book);
@@ -106,6 +108,9 @@ setup_defaults(void)
 	// Default main hash table size in megabytes
 	conf.hash_table_size_mb = 32;
 
+	// Number of search threads, lazy SMP helpers are started if above one
+	conf.thread_count = 1;
+
 	conf.book_path = NULL;   // book path, none by default
 	conf.book_type = bt_empty;  // use the empty book by default
 
@@ -127,8 +132,18 @@ setup_defaults(void)
 	env = getenv("TALTOS_USE_NO_NULLM");
 	conf.search.use_null_moves = (env == NULL || env[0] == '0');
 
-	env = getenv("TALTOS_USE_PVC");
-	conf.search.use_pv_cleanup = (env != NULL && env[0] != '0');
+	env = getenv("TALTOS_USE_NO_FP");
+	conf.search.use_futility_pruning = (env == NULL || env[0] == '0');
+
+	env = getenv("TALTOS_USE_NO_RFP");
+	conf.search.use_reverse_futility_pruning =
+	    (env == NULL || env[0] == '0');
+
+	env = getenv("TALTOS_USE_NO_QP");
+	conf.search.use_qsearch_pruning = (env == NULL || env[0] == '0');
+
+	env = getenv("TALTOS_USE_NO_SE");
+	conf.search.use_singular_extensions = (env == NULL || env[0] == '0');
 
 	env = getenv("TALTOS_USE_SRC");
 	conf.search.use_strict_repetition_check =
@@ -151,6 +166,33 @@ setup_defaults(void)
 	conf.search.use_beta_extensions =
 	    (env == NULL || env[0] == '0');
 
+	env = getenv("TALTOS_USE_NOAW");
+	conf.search.use_aspiration_windows =
+	    (env == NULL || env[0] == '0');
+
+	conf.search.use_move_order_timing = false;
+
+	/*
+	 * Quiet moves beyond the tenth move are ordered without describing
+	 * them. Ordering all quiet moves cheaply at low depths is disabled
+	 * by default, it costs more nodes than it saves time.
+	 */
+	conf.search.cheap_move_order_index = 10;
+	conf.search.cheap_move_order_depth = 0;
+
+	conf.search.futility_margins[0] = 150;
+	conf.search.futility_margins[1] = 150;
+	conf.search.futility_margins[2] = 300;
+	conf.search.futility_margins[3] = 500;
+
+	conf.search.reverse_futility_margins[0] = 120;
+	conf.search.reverse_futility_margins[1] = 120;
+	conf.search.reverse_futility_margins[2] = 240;
+	conf.search.reverse_futility_margins[3] = 360;
+
+	conf.search.singular_extension_depth = 8 * PLY;
+	conf.search.singular_extension_margin = 3;
+
 	conf.display_name = "Taltos";
 	conf.display_name_postfix = "";
 }
@@ -166,6 +208,14 @@ setup_display_name(void)
 		strcat(name, "-noLMP");
 	if (!conf.search.use_null_moves)
 		strcat(name, "-nonullm");
+	if (!conf.search.use_futility_pruning)
+		strcat(name, "-noFP");
+	if (!conf.search.use_reverse_futility_pruning)
+		strcat(name, "-noRFP");
+	if (!conf.search.use_qsearch_pruning)
+		strcat(name, "-noQP");
+	if (!conf.search.use_singular_extensions)
+		strcat(name, "-noSE");
 
 	conf.display_name = name;
 }
@@ -191,7 +241,7 @@ set_default_hash_size(const char *arg)
 	if (!ht_is_mb_size_valid(n)) {
 		(void) fprintf(stderr,
 		    "Invalid hash table size \"%s\".\n"
-		    "Must be a power of two, minimum %u, maximum %u.\n",
+		    "Minimum %u, maximum %u.\n",
 		    arg, ht_min_size_mb(), ht_max_size_mb());
 		exit(EXIT_FAILURE);
 	}
@@ -199,6 +249,48 @@ set_default_hash_size(const char *arg)
 	conf.hash_table_size_mb = n;
 }
 
+static void
+set_thread_count(const char *arg)
+{
+	char *endptr;
+	unsigned long n;
+
+	if (arg == NULL)
+		usage(EXIT_FAILURE);
+
+	n = strtoul(arg, &endptr, 10);
+
+	if (n == 0 || *endptr != '\0')
+		usage(EXIT_FAILURE);
+
+	if (n > MAX_THREAD_COUNT) {
+		(void) fprintf(stderr,
+		    "Invalid thread count \"%s\".\n"
+		    "Must be between 1 and %u.\n",
+		    arg, (unsigned)MAX_THREAD_COUNT);
+		exit(EXIT_FAILURE);
+	}
+
+	conf.thread_count = n;
+}
+
+static unsigned
+parse_uint_arg(const char *arg)
+{
+	char *endptr;
+	unsigned long n;
+
+	if (arg == NULL)
+		usage(EXIT_FAILURE);
+
+	n = strtoul(arg, &endptr, 10);
+
+	if (*endptr != '\0' || n > UINT_MAX)
+		usage(EXIT_FAILURE);
+
+	return (unsigned)n;
+}
+
 static void
 process_args(char **arg)
 {
@@ -238,6 +330,22 @@ process_args(char **arg)
 		else if (strcmp(*arg, "--nolmp") == 0) {
 			conf.search.use_LMP = false;
 		}
+		else if (strcmp(*arg, "--nofp") == 0) {
+			conf.search.use_futility_pruning = false;
+		}
+		else if (strcmp(*arg, "--norfp") == 0) {
+			conf.search.use_reverse_futility_pruning = false;
+		}
+		else if (strcmp(*arg, "--noqp") == 0) {
+			conf.search.use_qsearch_pruning = false;
+		}
+		else if (strcmp(*arg, "--nose") == 0) {
+			conf.search.use_singular_extensions = false;
+		}
+		else if (strcmp(*arg, "--se_depth") == 0) {
+			conf.search.singular_extension_depth =
+			    (int)parse_uint_arg(*++arg) * PLY;
+		}
 		else if (strcmp(*arg, "--nonullm") == 0) {
 			conf.search.use_null_moves = false;
 		}
@@ -245,9 +353,6 @@ process_args(char **arg)
 			conf.search.use_repetition_check = true;
 			conf.search.use_strict_repetition_check = true;
 		}
-		else if (strcmp(*arg, "--PVC") == 0) {
-			conf.search.use_pv_cleanup = true;
-		}
 		else if (strcmp(*arg, "--AM") == 0) {
 			conf.search.use_advanced_move_order = true;
 		}
@@ -257,9 +362,26 @@ process_args(char **arg)
 		else if (strcmp(*arg, "--noBE") == 0) {
 			conf.search.use_beta_extensions = false;
 		}
+		else if (strcmp(*arg, "--noAW") == 0) {
+			conf.search.use_aspiration_windows = false;
+		}
+		else if (strcmp(*arg, "--mo_timing") == 0) {
+			conf.search.use_move_order_timing = true;
+		}
+		else if (strcmp(*arg, "--cheap_mo_index") == 0) {
+			conf.search.cheap_move_order_index =
+			    parse_uint_arg(*++arg);
+		}
+		else if (strcmp(*arg, "--cheap_mo_depth") == 0) {
+			conf.search.cheap_move_order_depth =
+			    (int)parse_uint_arg(*++arg) * PLY;
+		}
 		else if (strcmp(*arg, "--hash") == 0) {
 			set_default_hash_size(*++arg);
 		}
+		else if (strcmp(*arg, "--threads") == 0) {
+			set_thread_count(*++arg);
+		}
 		else if (strcmp(*arg, "--name_postfix") == 0) {
 			conf.display_name_postfix = *++arg;
 		}
@@ -282,14 +404,23 @@ usage(int status)
 	    "  --book path         load polyglot book at path\n"
 	    "  --fenbook path      load FEN book at path\n"
 	    "  --hash              hash table size in megabytes\n"
+	    "  --threads           number of search threads\n"
 	    "  --unicode           use some unicode characters in the output\n"
 	    "  --nolmr             do not use LMR heuristics\n"
 	    "  --nolmp             do not use LMP heuristics\n"
+	    "  --nofp              do not use futility pruning\n"
+	    "  --norfp             do not use reverse futility pruning\n"
+	    "  --noqp              do not use delta and SEE pruning in qsearch\n"
+	    "  --nose              do not use singular extensions\n"
+	    "  --se_depth          try singular extensions from this depth on\n"
 	    "  --nonullm           do not use null move heuristics\n"
 	    "  --SRC               strict repetition checking during search\n"
 	    "  --AM                Use advanced move ordering - 1 ply search\n"
 	    "  --HH                Use move history heuristics\n"
-	    "  --PVC               PV cleanup - attempt to report cleaner PV\n"
+	    "  --noAW              do not use aspiration windows\n"
+	    "  --mo_timing         measure the time spent ordering moves\n"
+	    "  --cheap_mo_index    order quiet moves beyond this index cheaply\n"
+	    "  --cheap_mo_depth    order quiet moves cheaply up to this depth\n"
 	    "  --name_postfix      Append string to display name\n",
 	    author_name, progname);
 	exit(status);
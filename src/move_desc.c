@@ -170,8 +170,8 @@ describe_source(struct move_desc *desc, const struct position *pos)
 
 	desc->src_sq.index = from;
 	desc->src_sq.piece = pos->board[from];
-	desc->src_sq.rreach = pos->rays[pr_rook][from];
-	desc->src_sq.breach = pos->rays[pr_bishop][from];
+	desc->src_sq.rreach = rook_reach(pos, from);
+	desc->src_sq.breach = bishop_reach(pos, from);
 	desc->src_sq.attacks = find_piece_attacks(&desc->src_sq);
 	desc->src_sq.attacks &= pos->occupied;
 	// desc->src_sq.attackers is not needed
@@ -187,8 +187,8 @@ describe_destination(struct move_desc *desc, const struct position *pos)
 
 	desc->dst_sq.index = to;
 	desc->dst_sq.piece = mresultp(desc->move);
-	desc->dst_sq.rreach = pos->rays[pr_rook][to];
-	desc->dst_sq.breach = pos->rays[pr_bishop][to];
+	desc->dst_sq.rreach = rook_reach(pos, to);
+	desc->dst_sq.breach = bishop_reach(pos, to);
 
 	if (is_nonempty(desc->src_sq.rreach & to64))
 		desc->dst_sq.rreach |= desc->src_sq.rreach & rook_masks[to];
@@ -302,10 +302,10 @@ unblocks_passed_pawn(const struct position *pos, move m)
 	return is_nonempty(p);
 }
 
-static void
-eval_piece_placement(struct move_desc *desc, const struct position *pos)
+int
+move_placement_value(const struct position *pos, move m)
 {
-	static char move_dest_table[64] = {
+	static const char move_dest_table[64] = {
 		4, 4, 4, 4, 4, 4, 4, 4,
 		3, 3, 3, 3, 3, 3, 3, 3,
 		0, 1, 2, 3, 3, 2, 1, 0,
@@ -316,13 +316,19 @@ eval_piece_placement(struct move_desc *desc, const struct position *pos)
 		0, 0, 0, 0, 0, 0, 0, 0
 	};
 
+	if (mresultp(m) == king && is_nonempty(pos->rq[1]))
+		return 0;
+
+	return move_dest_table[mto(m)] - move_dest_table[mfrom(m)];
+}
+
+static void
+eval_piece_placement(struct move_desc *desc, const struct position *pos)
+{
 	if (desc->SEE_value < 0)
 		return;
 
-	if (desc->dst_sq.piece != king || is_empty(pos->rq[1])) {
-		desc->value += move_dest_table[desc->dst_sq.index];
-		desc->value -= move_dest_table[desc->src_sq.index];
-	}
+	desc->value += move_placement_value(pos, desc->move);
 }
 
 static void
@@ -464,8 +470,8 @@ find_hanging_pieces(struct position *pos)
 
 		sq.index = bsf(pieces);
 		sq.piece = pos->board[sq.index];
-		sq.rreach = pos->rays[pr_rook][sq.index];
-		sq.breach = pos->rays[pr_bishop][sq.index];
+		sq.rreach = rook_reach(pos, sq.index);
+		sq.breach = bishop_reach(pos, sq.index);
 		int player = pos_player_at(pos, sq.index);
 		uint64_t attackers = find_attackers(&sq, pos);
 		uint64_t code = attack_code(pos, attackers, player);
@@ -61,6 +61,13 @@ move_desc_setup(struct move_desc *desc)
 
 void describe_move(struct move_desc*, const struct position*, move);
 
+/*
+ * The part of the value computed by describe_move, that only depends on
+ * the squares the piece moves between. Cheap enough to be used for
+ * ordering moves without describing them.
+ */
+int move_placement_value(const struct position*, move);
+
 void find_hanging_pieces(struct position*);
 
 #endif
@@ -285,7 +285,7 @@ gen_bishop_moves(struct move_gen *mg)
 	for (; is_nonempty(bishops); bishops = reset_lsb(bishops)) {
 		uint64_t from64 = lsb(bishops);
 		int from = bsf(bishops);
-		uint64_t dst_map = mg->pos->rays[pr_bishop][from];
+		uint64_t dst_map = bishop_reach(mg->pos, from);
 		if (is_nonempty(mg->pinned_diag & from64))
 			dst_map &= diag_masks[from];
 		else if (is_nonempty(mg->pinned_adiag & from64))
@@ -307,7 +307,7 @@ gen_rook_moves(struct move_gen *mg)
 		uint64_t from64 = lsb(rooks);
 		int from = bsf(rooks);
 
-		uint64_t dst_map = mg->pos->rays[pr_rook][from];
+		uint64_t dst_map = rook_reach(mg->pos, from);
 		if (is_nonempty(mg->pinned_hor & from64))
 			dst_map &= hor_masks[from];
 		else if (is_nonempty(mg->pinned_ver & from64))
@@ -368,6 +368,8 @@ gen_moves(const struct position *pos, move moves[static MOVE_ARRAY_LENGTH])
 {
 	struct move_gen mg[1];
 
+	assert(position_is_complete(pos));
+
 	init_data(mg, pos, moves);
 	mg->only_queen_promotions = false;
 	if (popcnt(pos_king_attackers(pos)) <= 1) {
@@ -399,6 +401,7 @@ gen_captures(const struct position *pos,
 		move moves[static MOVE_ARRAY_LENGTH])
 {
 	assert(!is_in_check(pos));
+	assert(position_is_complete(pos));
 
 	if (is_empty(pos->attack[0] & pos->map[1]) && !pos_has_ep_target(pos)) {
 		*moves = 0;
@@ -25,6 +25,7 @@
  */
 
 #include <assert.h>
+#include <stdalign.h>
 #include <string.h>
 
 #include "search.h"
@@ -61,13 +62,71 @@ reset_entry_value(int64_t entry, int16_t value)
 }
 
 static bool use_history;
+static _Thread_local bool use_timing;
+
+static _Thread_local struct move_order_stats stats;
 
 struct history_value {
 	uintmax_t occurence;
 	uintmax_t cutoff_count;
 };
 
-static struct history_value history[2][PIECE_ARRAY_SIZE][64];
+/*
+ * Continuation history: cutoff statistics of a move, indexed by a move
+ * made one or two plies earlier, and the move itself. Pieces are indexed
+ * by type only, the previous move implies which side is to move.
+ * The counters are halved before they would overflow, and at the start
+ * of each search, so old statistics fade away.
+ */
+struct cont_history_value {
+	uint16_t occurence;
+	uint16_t cutoff_count;
+};
+
+enum { piece_type_count = PIECE_ARRAY_SIZE / 2 };
+
+/*
+ * Every search thread owns one of these, so the threads never write
+ * to the same cache lines while updating the statistics.
+ */
+struct move_history {
+	/*
+	 * history[0] - statistics collected during the previous search
+	 * history[1] - statistics collected during the current search
+	 */
+	alignas(64)
+	struct history_value history[2][PIECE_ARRAY_SIZE][64];
+
+	/*
+	 * The last quiet move causing a cutoff in reply to a move, indexed
+	 * by the history side, and the piece and destination of the move
+	 * replied to.
+	 */
+	move counter_moves[2][piece_type_count][64];
+
+	struct cont_history_value
+	    continuation[2][piece_type_count][64][piece_type_count][64];
+
+	/*
+	 * Capture history: cutoff statistics of captures, indexed by the
+	 * moving piece, the destination, and the captured piece.
+	 */
+	struct cont_history_value
+	    captures[piece_type_count][64][piece_type_count];
+};
+
+struct move_history*
+move_history_create(void)
+{
+	return xaligned_calloc(alignof(struct move_history),
+	    1, sizeof(struct move_history));
+}
+
+static bool
+uses_history(const struct move_order *mo)
+{
+	return use_history && mo->history != NULL;
+}
 
 void
 move_order_setup(struct move_order *mo, const struct position *pos,
@@ -86,7 +145,12 @@ move_order_setup(struct move_order *mo, const struct position *pos,
 	mo->hint_count = 0;
 	mo->pos = pos;
 	mo->history_side = hside;
-	mo->strong_capture_entries_added = false;
+	mo->previous_moves[0] = 0;
+	mo->previous_moves[1] = 0;
+	mo->history = NULL;
+	mo->stage = mo_stage_strong_captures;
+	mo->cheap_scoring_index = UINT_MAX;
+	mo->lower_SEE_losing_captures = false;
 	mo->LMR_subject_index = -1;
 	move_desc_setup(&mo->desc);
 }
@@ -174,6 +238,45 @@ move_order_add_killer(struct move_order *mo, move killer_move)
 	mo->killers[0] = killer_move;
 }
 
+static move*
+counter_move_slot(const struct move_order *mo)
+{
+	move prev = mo->previous_moves[0];
+
+	return &(mo->history->counter_moves[mo->history_side]
+	    [mresultp(prev) / 2][mto(prev)]);
+}
+
+void
+move_order_add_counter_move(struct move_order *mo, move m)
+{
+	if (mo->history != NULL && mo->previous_moves[0] != 0)
+		*counter_move_slot(mo) = m;
+}
+
+static move
+counter_move(const struct move_order *mo)
+{
+	if (mo->history == NULL || mo->previous_moves[0] == 0)
+		return 0;
+
+	return *counter_move_slot(mo);
+}
+
+/*
+ * The counter move is ordered before other quiet moves, unless it seems
+ * to lose material.
+ */
+static int16_t
+apply_counter_move_value(const struct move_order *mo, move m, int16_t value)
+{
+	if (value > -150 && value < counter_move_value
+	    && m == counter_move(mo))
+		return counter_move_value;
+
+	return value;
+}
+
 static bool
 is_killer(const struct move_order *mo, move m)
 {
@@ -225,6 +328,36 @@ is_strong_capture(const struct position *pos, move m)
 	return false;
 }
 
+static struct cont_history_value*
+capture_history_entry(struct move_history *h, move m)
+{
+	return &(h->captures[mresultp(m) / 2][mto(m)][mcapturedp(m) / 2]);
+}
+
+/*
+ * A small bonus for captures that caused cutoffs before, only used
+ * for breaking ties between captures of similar value, thus it never
+ * turns a capture with a non-positive value into one with a positive
+ * value. That would change which captures are pruned in quiescence
+ * search. The capture history is used even when the history of quiet
+ * moves is not.
+ */
+static int
+capture_history_value(const struct move_order *mo, move m, int value)
+{
+	if (mo->history == NULL)
+		return value;
+
+	const struct cont_history_value *c =
+	    capture_history_entry(mo->history, m);
+	int bonus = (c->cutoff_count * 24) / (c->occurence + 32);
+
+	if (value <= 0 && value + bonus > 0)
+		return 0;
+
+	return value + bonus;
+}
+
 static void
 add_strong_capture_entries(struct move_order *mo)
 {
@@ -235,52 +368,227 @@ add_strong_capture_entries(struct move_order *mo)
 			int value = 1000 + piece_value[mcapturedp(m)];
 			if (is_nonempty(mto64(m) & mo->pos->attack[1]))
 				value -= piece_value[mresultp(m)] / 20;
+			value = capture_history_value(mo, m, value);
 			insert(mo, create_entry(m, value, false));
 		}
 		else {
 			++i;
 		}
 	}
-	mo->strong_capture_entries_added = true;
+	mo->stage = mo_stage_captures;
+}
+
+static struct cont_history_value*
+continuation_entry(struct move_history *h, move prev, move m, unsigned ply)
+{
+	return &(h->continuation[ply][mresultp(prev) / 2][mto(prev)]
+	    [mresultp(m) / 2][mto(m)]);
 }
 
 static int16_t
 move_history_value(const struct move_order *mo, move m)
 {
 	const struct history_value *h0 =
-	    &(history[0][mresultp(m) + mo->history_side][mto(m)]);
+	    &(mo->history->history[0][mresultp(m) + mo->history_side][mto(m)]);
 	const struct history_value *h1 =
-	    &(history[1][mresultp(m) + mo->history_side][mto(m)]);
+	    &(mo->history->history[1][mresultp(m) + mo->history_side][mto(m)]);
 
 	int16_t value = 0;
 
 	value += (int16_t)((h0->cutoff_count * 15) / (h0->occurence + 20));
 	value += (int16_t)((h1->cutoff_count * 60) / (h1->occurence + 100));
 
+	for (unsigned ply = 0; ply < ARRAY_LENGTH(mo->previous_moves); ++ply) {
+		move prev = mo->previous_moves[ply];
+		if (prev == 0)
+			continue;
+
+		const struct cont_history_value *c =
+		    continuation_entry(mo->history, prev, m, ply);
+		value += (int16_t)((c->cutoff_count * 40) / (c->occurence + 50));
+	}
+
 	return value;
 }
 
+static int64_t
+describe_entry(struct move_order *mo, move m, int16_t *value)
+{
+	static const int16_t base = -100;
+
+	describe_move(&mo->desc, mo->pos, m);
+	bool check = mo->desc.direct_check;
+	check |= mo->desc.discovered_check;
+
+	*value = base;
+	*value += mo->desc.value;
+	if (uses_history(mo))
+		*value += move_history_value(mo, m);
+	*value = apply_counter_move_value(mo, m, *value);
+
+	return create_entry(m, *value, check);
+}
+
 static void
-add_all_entries(struct move_order *mo)
+add_capture_entries(struct move_order *mo)
+{
+	for (unsigned i = 0; i < mo->raw_move_count; ) {
+		move m = mo->moves[i];
+		if (is_capture(m)) {
+			int16_t value;
+			remove_raw_move(mo, i);
+			int64_t entry = describe_entry(mo, m, &value);
+			value = capture_history_value(mo, m, value);
+			if (mo->lower_SEE_losing_captures
+			    && mo->desc.SEE_value < 0 && value > 0)
+				value = 0;
+			entry = reset_entry_value(entry, value);
+			insert(mo, entry);
+		}
+		else {
+			++i;
+		}
+	}
+	mo->stage = mo_stage_killers;
+}
+
+/*
+ * Killer moves found among the remaining moves are described before
+ * any other move, and are picked before the rest of the moves.
+ * A killer move that turns out to lose material is left among the
+ * raw moves, to be ordered just like any other move.
+ */
+static void
+add_killer_entries(struct move_order *mo)
+{
+	for (unsigned i = 0; i < mo->raw_move_count; ) {
+		move m = mo->moves[i];
+		int16_t value;
+
+		if (is_killer(mo, m)) {
+			int64_t entry = describe_entry(mo, m, &value);
+			if (value > -150) {
+				remove_raw_move(mo, i);
+				if (value < killer_value)
+					entry = reset_entry_value(entry,
+					    killer_value);
+				insert(mo, entry);
+				continue;
+			}
+		}
+		++i;
+	}
+	mo->stage = mo_stage_rest;
+}
+
+static int64_t
+cheap_entry(const struct move_order *mo, move m)
 {
 	static const int16_t base = -100;
 
+	int16_t value = base;
+	value += move_placement_value(mo->pos, m);
+	if (uses_history(mo))
+		value += move_history_value(mo, m);
+
+	return create_entry(m, value, false);
+}
+
+static void
+sort_entries(struct move_order *mo, unsigned first)
+{
+	for (unsigned i = first + 1; i < mo->entry_count; ++i) {
+		int64_t entry = mo->entries[i];
+		unsigned j = i;
+		while (j > first && mo->entries[j - 1] < entry) {
+			mo->entries[j] = mo->entries[j - 1];
+			--j;
+		}
+		mo->entries[j] = entry;
+	}
+}
+
+/*
+ * The moves left at this stage are quiet moves. When some of them are
+ * beyond the cheap scoring index, all of them are scored cheaply first,
+ * and only the best few, those expected to be picked before the cheap
+ * scoring index, are described. Promotions are always described.
+ */
+static void
+add_all_entries(struct move_order *mo)
+{
+	unsigned first = mo->entry_count;
+	unsigned described_count = 0;
+	int16_t value;
+
+	if (mo->cheap_scoring_index > mo->picked_count)
+		described_count = mo->cheap_scoring_index - mo->picked_count;
+
+	if (described_count >= mo->raw_move_count) {
+		for (unsigned i = 0; i < mo->raw_move_count; ++i)
+			insert(mo, describe_entry(mo, mo->moves[i], &value));
+		mo->raw_move_count = 0;
+		return;
+	}
+
 	for (unsigned i = 0; i < mo->raw_move_count; ++i) {
 		move m = mo->moves[i];
-
-		describe_move(&mo->desc, mo->pos, m);
-		bool check = mo->desc.direct_check;
-		check |= mo->desc.discovered_check;
-
-		int16_t value = base;
-		value += mo->desc.value;
-		if (use_history)
-			value += move_history_value(mo, m);
-		if (value > -150 && value < killer_value && is_killer(mo, m))
-			value = killer_value;
-		insert(mo, create_entry(m, value, check));
+		if (mtype(m) == mt_promotion) {
+			insert(mo, describe_entry(mo, m, &value));
+		}
+		else {
+			insert(mo, cheap_entry(mo, m));
+			stats.cheap_scored_moves++;
+		}
 	}
 	mo->raw_move_count = 0;
+
+	for (unsigned i = first; i < first + described_count; ++i) {
+		move m = mo_entry_move(mo->entries[i]);
+		if (mtype(m) != mt_promotion) {
+			mo->entries[i] = describe_entry(mo, m, &value);
+			stats.cheap_scored_moves--;
+		}
+	}
+	sort_entries(mo, first);
+}
+
+static void
+add_stage_entries(struct move_order *mo)
+{
+	switch (mo->stage) {
+	case mo_stage_strong_captures:
+		add_strong_capture_entries(mo);
+		break;
+	case mo_stage_captures:
+		add_capture_entries(mo);
+		break;
+	case mo_stage_killers:
+		add_killer_entries(mo);
+		break;
+	default:
+		add_all_entries(mo);
+		break;
+	}
+}
+
+static void
+add_next_stage_entries(struct move_order *mo)
+{
+	enum move_order_stage stage = mo->stage;
+	unsigned entry_count = mo->entry_count;
+
+	if (use_timing) {
+		taltos_systime start = xnow();
+		add_stage_entries(mo);
+		stats.stage_nanoseconds[stage] += xnanoseconds_since(start);
+	}
+	else {
+		add_stage_entries(mo);
+	}
+
+	stats.stage_runs[stage]++;
+	stats.stage_moves[stage] += mo->entry_count - entry_count;
 }
 
 void
@@ -288,12 +596,8 @@ move_order_pick_next(struct move_order *mo)
 {
 	invariant(!move_order_done(mo));
 
-	while (mo->picked_count == mo->entry_count) {
-		if (!mo->strong_capture_entries_added)
-			add_strong_capture_entries(mo);
-		else
-			add_all_entries(mo);
-	}
+	while (mo->picked_count == mo->entry_count)
+		add_next_stage_entries(mo);
 
 	invariant(mo->picked_count < mo->entry_count);
 	mo->picked_count++;
@@ -315,18 +619,85 @@ move_order_disable_history(void)
 }
 
 void
-move_order_swap_history(void)
+move_order_enable_timing(void)
+{
+	use_timing = true;
+}
+
+void
+move_order_disable_timing(void)
+{
+	use_timing = false;
+}
+
+struct move_order_stats
+move_order_stats(void)
+{
+	return stats;
+}
+
+static void
+halve_cont_history_value(struct cont_history_value *c)
+{
+	c->occurence /= 2;
+	c->cutoff_count /= 2;
+}
+
+static void
+age_continuation_history(struct move_history *h)
+{
+	struct cont_history_value *c = &h->continuation[0][0][0][0][0];
+	size_t count = sizeof(h->continuation) / sizeof(*c);
+
+	for (size_t i = 0; i < count; ++i)
+		halve_cont_history_value(c + i);
+}
+
+static void
+age_capture_history(struct move_history *h)
+{
+	struct cont_history_value *c = &h->captures[0][0][0];
+	size_t count = sizeof(h->captures) / sizeof(*c);
+
+	for (size_t i = 0; i < count; ++i)
+		halve_cont_history_value(c + i);
+}
+
+static void
+adjust_continuation_history(const struct move_order *mo,
+			move m, bool is_cutoff)
+{
+	for (unsigned ply = 0; ply < ARRAY_LENGTH(mo->previous_moves); ++ply) {
+		move prev = mo->previous_moves[ply];
+		if (prev == 0)
+			continue;
+
+		struct cont_history_value *c =
+		    continuation_entry(mo->history, prev, m, ply);
+		if (c->occurence == UINT16_MAX)
+			halve_cont_history_value(c);
+		c->occurence++;
+		if (is_cutoff)
+			c->cutoff_count++;
+	}
+}
+
+void
+move_history_swap(struct move_history *h)
 {
+	age_capture_history(h);
+
 	if (use_history) {
-		memcpy(history[0], history[1], sizeof(*history));
-		memset(history[1], 0, sizeof(history[1]));
+		memcpy(h->history[0], h->history[1], sizeof(h->history[0]));
+		memset(h->history[1], 0, sizeof(h->history[1]));
+		age_continuation_history(h);
 	}
 }
 
 void
 move_order_adjust_history_on_cutoff(const struct move_order *mo)
 {
-	if (!use_history)
+	if (!uses_history(mo))
 		return;
 
 	if (mo->count == 1)
@@ -345,10 +716,41 @@ move_order_adjust_history_on_cutoff(const struct move_order *mo)
 	for (unsigned i = 0; i < mo->picked_count; ++i) {
 		move m = mo_entry_move(mo->entries[i]);
 		struct history_value *h =
-		    &(history[1][mresultp(m) + side][mto(m)]);
+		    &(mo->history->history[1][mresultp(m) + side][mto(m)]);
 
 		h->occurence++;
 		if (i + 1 == mo->picked_count)
 			h->cutoff_count++;
+
+		adjust_continuation_history(mo, m, i + 1 == mo->picked_count);
+	}
+}
+
+/*
+ * Unlike the history of quiet moves, the capture history is also
+ * updated at low depths, and in quiescence search, where most of the
+ * captures are searched.
+ */
+void
+move_order_adjust_capture_history_on_cutoff(const struct move_order *mo)
+{
+	if (mo->history == NULL)
+		return;
+
+	if (mo->count == 1)
+		return;
+
+	for (unsigned i = 0; i < mo->picked_count; ++i) {
+		move m = mo_entry_move(mo->entries[i]);
+		if (!is_capture(m))
+			continue;
+
+		struct cont_history_value *c =
+		    capture_history_entry(mo->history, m);
+		if (c->occurence == UINT16_MAX)
+			halve_cont_history_value(c);
+		c->occurence++;
+		if (i + 1 == mo->picked_count)
+			c->cutoff_count++;
 	}
 }
@@ -67,9 +67,47 @@ mo_entry_is_hint(int64_t entry)
 }
 
 enum {
-	killer_value = 70
+	killer_value = 70,
+	counter_move_value = -50
 };
 
+enum move_order_stage {
+	mo_stage_strong_captures,
+	mo_stage_captures,
+	mo_stage_killers,
+	mo_stage_rest,
+	mo_stage_count
+};
+
+/*
+ * Per thread counters of the work done in each stage of move ordering.
+ * The time spent in each stage is only measured while timing is enabled,
+ * see move_order_enable_timing.
+ */
+struct move_order_stats {
+	uintmax_t stage_runs[mo_stage_count];
+	uintmax_t stage_moves[mo_stage_count];
+	uintmax_t stage_nanoseconds[mo_stage_count];
+	uintmax_t cheap_scored_moves;
+};
+
+/*
+ * History heuristics, counter moves, and continuation history - the
+ * statistics collected about moves during search, owned by a search
+ * thread.
+ */
+struct move_history;
+
+struct move_history *move_history_create(void)
+	attribute(returns_nonnull, warn_unused_result, malloc);
+
+/*
+ * Called before each search, the statistics collected in the previous
+ * search become less relevant.
+ */
+void move_history_swap(struct move_history*)
+	attribute(nonnull);
+
 struct move_order {
 	move moves[MOVE_ARRAY_LENGTH];
 	unsigned raw_move_count;
@@ -80,13 +118,48 @@ struct move_order {
 	unsigned count;
 	unsigned picked_count;
 	move killers[2];
+
+	/*
+	 * The moves leading to the position, made one and two plies ago,
+	 * used for indexing the counter move, and the continuation history.
+	 * Zero when not known, e.g. at the root, or after a null move.
+	 */
+	move previous_moves[2];
+
+	/*
+	 * The statistics of the search thread, NULL when moves are ordered
+	 * outside of search.
+	 */
+	struct move_history *history;
+
 	bool is_started;
 	bool is_already_sorted;
 	unsigned hint_count;
 	const struct position *pos;
 	int history_side;
 
-	bool strong_capture_entries_added;
+	/*
+	 * The moves are described and inserted into the entries array
+	 * in stages, only when the entries of the previous stage are
+	 * all picked. If one of the first few moves produces a cutoff,
+	 * the rest of the moves are never described.
+	 */
+	enum move_order_stage stage;
+
+	/*
+	 * Quiet moves that are not expected to be picked before this
+	 * index are only scored using the history and piece placement,
+	 * without calling describe_move. UINT_MAX by default, i.e. all
+	 * moves are described.
+	 */
+	unsigned cheap_scoring_index;
+
+	/*
+	 * Captures losing material according to SEE are given a value of
+	 * zero at most, so quiescence search can prune them along with
+	 * the other moves not expected to gain anything. False by default.
+	 */
+	bool lower_SEE_losing_captures;
 
 	int LMR_subject_index;
 };
@@ -126,6 +199,9 @@ int move_order_add_hint(struct move_order*, move hint_move, int16_t priority)
 void move_order_add_killer(struct move_order*, move killer_move)
 	attribute(nonnull);
 
+void move_order_add_counter_move(struct move_order*, move counter_move)
+	attribute(nonnull);
+
 static inline unsigned
 move_order_remaining(const struct move_order *mo)
 {
@@ -138,11 +214,48 @@ move_order_done(const struct move_order *mo)
 	return mo->picked_count == mo->count;
 }
 
+/*
+ * A point in picking the moves, that can be returned to after picking
+ * some more moves ahead of time. The entries already picked are never
+ * moved again, so later picks after a rewind yield the same moves, in
+ * the same order, without describing any of them again.
+ */
+struct move_order_mark {
+	unsigned picked_count;
+	int LMR_subject_index;
+};
+
+static inline struct move_order_mark
+move_order_mark(const struct move_order *mo)
+{
+	return (struct move_order_mark) {
+		.picked_count = mo->picked_count,
+		.LMR_subject_index = mo->LMR_subject_index };
+}
+
+static inline void
+move_order_rewind(struct move_order *mo, struct move_order_mark mark)
+{
+	invariant(mark.picked_count <= mo->picked_count);
+	mo->picked_count = mark.picked_count;
+	mo->LMR_subject_index = mark.LMR_subject_index;
+}
+
 void move_order_adjust_history_on_cutoff(const struct move_order*)
 	attribute(nonnull);
 
+void move_order_adjust_capture_history_on_cutoff(const struct move_order*)
+	attribute(nonnull);
+
 void move_order_enable_history(void);
 void move_order_disable_history(void);
-void move_order_swap_history(void);
+
+/*
+ * Timing is enabled per thread, each search thread sets it for itself
+ * when starting a search.
+ */
+void move_order_enable_timing(void);
+void move_order_disable_timing(void);
+struct move_order_stats move_order_stats(void);
 
 #endif
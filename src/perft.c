@@ -149,7 +149,7 @@ divide_init(const struct position *pos, unsigned depth,
 
 	struct divide_info *dinfo;
 
-	dinfo = xaligned_alloc(pos_alignment, sizeof *dinfo);
+	dinfo = xaligned_alloc(alignof(struct divide_info), sizeof *dinfo);
 	dinfo->depth = depth;
 	dinfo->turn = turn;
 	dinfo->is_ordered = ordered;
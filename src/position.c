@@ -35,7 +35,6 @@
 #include "move_desc.h"
 #include "flip_chess_board.h"
 #include "flip_board_pairs.h"
-#include "flip_ray_array.h"
 
 #include "bitboard_constants.inc"
 
@@ -156,8 +155,6 @@ has_potential_ep_captor(struct position *pos, int index)
  * maps are calculated as if they could jump over the king of the side to move.
  * This makes it easier to find squares where a king in check can move to.
  */
-static void generate_all_rays(struct position*);
-static void update_all_rays(struct position*, move);
 static void generate_player_attacks(struct position*);
 static void generate_opponent_attacks(struct position*);
 static void search_king_attacks(struct position*);
@@ -202,92 +199,117 @@ search_pins(struct position *pos)
 	search_player_king_pins(pos, 1);
 }
 
-static void
-generate_rays(struct position *pos, uint64_t rays[64], int dir, uint64_t edge)
-{
-	for (int from = 0; from < 64; ++from) {
-		uint64_t bit = bit64(from);
-		if (is_nonempty(edge & bit))
-			continue;
+/*
+ * The attack tables of sliding pieces. With PEXT, the relevant occupancy
+ * bits are used directly as an index, otherwise the magic multipliers
+ * generated by tools/gen_bb_constants.c are used.
+ * The attacks from a square include the first blocker in each direction,
+ * regardless of whether the square itself is occupied.
+ */
+struct slider_magic bishop_magics[64];
+struct slider_magic rook_magics[64];
 
-		uint64_t stop = edge | pos->occupied;
-		int i = from;
+static uint64_t bishop_attack_table[0x1480];
+static uint64_t rook_attack_table[0x19000];
 
-		do {
-			i += dir;
-			bit = bit64(i);
-			rays[from] |= bit;
-		} while (is_empty(stop & bit));
-	}
-}
+static const int rook_dirs[4] = {WEST, EAST, NORTH, SOUTH};
+static const uint64_t rook_edges[4] = {FILE_A, FILE_H, RANK_8, RANK_1};
+static const int bishop_dirs[4] = {
+	SOUTH + EAST, NORTH + WEST, SOUTH + WEST, NORTH + EAST};
+static const uint64_t bishop_edges[4] = {
+	RANK_1 | FILE_H, RANK_8 | FILE_A, RANK_1 | FILE_A, RANK_8 | FILE_H};
 
-static void
-generate_all_rays(struct position *pos)
+static uint64_t
+slow_ray(int from, int dir, uint64_t edge, uint64_t occupied)
 {
-	memset(pos->rays, 0, sizeof(pos->rays));
+	uint64_t ray = EMPTY;
+	uint64_t bit = bit64(from);
 
-	generate_rays(pos, pos->rays[pr_rook], WEST, FILE_A);
-	generate_rays(pos, pos->rays[pr_rook], EAST, FILE_H);
-	generate_rays(pos, pos->rays[pr_rook], NORTH, RANK_8);
-	generate_rays(pos, pos->rays[pr_rook], SOUTH, RANK_1);
-	generate_rays(pos, pos->rays[pr_bishop], SOUTH + EAST, RANK_1 | FILE_H);
-	generate_rays(pos, pos->rays[pr_bishop], NORTH + WEST, RANK_8 | FILE_A);
-	generate_rays(pos, pos->rays[pr_bishop], SOUTH + WEST, RANK_1 | FILE_A);
-	generate_rays(pos, pos->rays[pr_bishop], NORTH + EAST, RANK_8 | FILE_H);
-}
+	if (is_nonempty(edge & bit))
+		return EMPTY;
 
-static void
-update_rays_empty_square(uint64_t rays[64], const uint64_t masks[64], int i)
-{
-	uint64_t reach = rays[i];
-	for (uint64_t map = reach; is_nonempty(map); map = reset_lsb(map))
-		rays[bsf(map)] |= reach & masks[bsf(map)];
+	uint64_t stop = edge | occupied;
+	int i = from;
+
+	do {
+		i += dir;
+		bit = bit64(i);
+		ray |= bit;
+	} while (is_empty(stop & bit));
+
+	return ray;
 }
 
-static void
-update_all_rays_empty_square(struct position *pos, int i)
+static uint64_t
+slow_attacks(int from, const int dirs[4], const uint64_t edges[4],
+		uint64_t occupied)
 {
-	update_rays_empty_square(pos->rays[pr_rook], rook_masks, i);
-	update_rays_empty_square(pos->rays[pr_bishop], bishop_masks, i);
+	uint64_t attacks = EMPTY;
+
+	for (int i = 0; i < 4; ++i)
+		attacks |= slow_ray(from, dirs[i], edges[i], occupied);
+
+	return attacks;
 }
 
-static void
-update_rays_occupied_square(uint64_t rays[64], int i)
+/*
+ * The squares where a blocker changes the attacks, i.e. the empty board
+ * attacks, without the last square in each direction.
+ */
+static uint64_t
+relevant_occupancy_mask(int from, const int dirs[4], const uint64_t edges[4])
 {
-	uint64_t lower_half = rays[i] & (bit64(i) - 1);
-	uint64_t higher_half = rays[i] & ~lower_half;
+	uint64_t mask = EMPTY;
 
-	for (uint64_t map = lower_half; is_nonempty(map); map = reset_lsb(map))
-		rays[bsf(map)] &= ~higher_half;
+	for (int i = 0; i < 4; ++i)
+		mask |= slow_ray(from, dirs[i], edges[i], EMPTY) & ~edges[i];
 
-	for (uint64_t map = higher_half; is_nonempty(map); map = reset_lsb(map))
-		rays[bsf(map)] &= ~lower_half;
+	return mask;
 }
 
-static void
-update_all_rays_occupied_square(struct position *pos, int i)
+static uint64_t*
+init_slider_magic(struct slider_magic *m, uint64_t *attacks, int from,
+		const int dirs[4], const uint64_t edges[4], uint64_t magic)
 {
-	update_rays_occupied_square(pos->rays[pr_rook], i);
-	update_rays_occupied_square(pos->rays[pr_bishop], i);
+	size_t size = 0;
+
+	m->mask = relevant_occupancy_mask(from, dirs, edges);
+	m->attacks = attacks;
+#ifdef TALTOS_CAN_USE_INTEL_PDEP_PEXT_64
+	(void) magic;
+#else
+	m->magic = magic;
+	m->shift = 64 - popcnt(m->mask);
+#endif
+
+	// Iterate over all subsets of the mask
+	uint64_t subset = EMPTY;
+	do {
+		attacks[slider_index(m, subset)] =
+		    slow_attacks(from, dirs, edges, subset);
+		++size;
+		subset = (subset - m->mask) & m->mask;
+	} while (subset != EMPTY);
+
+	return attacks + size;
 }
 
-static void
-update_all_rays(struct position *pos, move m)
+void
+init_slider_attacks(void)
 {
-	update_all_rays_empty_square(pos, mfrom(m));
-	if (mtype(m) == mt_en_passant) {
-		update_all_rays_occupied_square(pos, mto(m));
-		update_all_rays_empty_square(pos, mto(m) + NORTH);
-	}
-	else if (!is_capture(m)) {
-		update_all_rays_occupied_square(pos, mto(m));
-		if (mtype(m) == mt_castle_kingside) {
-			update_all_rays_occupied_square(pos, sq_f8);
-		}
-		else if (mtype(m) == mt_castle_queenside) {
-			update_all_rays_occupied_square(pos, sq_d8);
-		}
-	}
+	uint64_t *attacks = bishop_attack_table;
+	for (int i = 0; i < 64; ++i)
+		attacks = init_slider_magic(bishop_magics + i, attacks, i,
+		    bishop_dirs, bishop_edges, bishop_magic_numbers[i]);
+	assert(attacks ==
+	    bishop_attack_table + ARRAY_LENGTH(bishop_attack_table));
+
+	attacks = rook_attack_table;
+	for (int i = 0; i < 64; ++i)
+		attacks = init_slider_magic(rook_magics + i, attacks, i,
+		    rook_dirs, rook_edges, rook_magic_numbers[i]);
+	assert(attacks ==
+	    rook_attack_table + ARRAY_LENGTH(rook_attack_table));
 }
 
 static uint64_t
@@ -296,7 +318,7 @@ bishop_attacks(uint64_t bishops, const struct position *pos)
 	uint64_t accumulator = EMPTY;
 
 	for (; is_nonempty(bishops); bishops = reset_lsb(bishops))
-		accumulator |= pos->rays[pr_bishop][bsf(bishops)];
+		accumulator |= bishop_reach(pos, bsf(bishops));
 
 	return accumulator;
 }
@@ -307,7 +329,7 @@ rook_attacks(uint64_t rooks, const struct position *pos)
 	uint64_t accumulator = EMPTY;
 
 	for (; is_nonempty(rooks); rooks = reset_lsb(rooks))
-		accumulator |= pos->rays[pr_rook][bsf(rooks)];
+		accumulator |= rook_reach(pos, bsf(rooks));
 
 	return accumulator;
 }
@@ -369,6 +391,50 @@ generate_opponent_attacks(struct position *pos)
 	accumulate_attacks(pos->attack + 1, pos->sliding_attacks + 1);
 }
 
+/*
+ * Update the attack maps in make_move, after the attack maps of the parent
+ * position were flipped. Sliding attacks always need to be recomputed,
+ * as the occupancy changed, but the attacks of pawns, knights, and kings
+ * only change if such a piece moved, or was captured. The player to move
+ * didn't move any pieces, but might have lost one.
+ */
+static void
+update_player_attacks(struct position *pos, move m)
+{
+	if (mcapturedp(m) == pawn)
+		pos->attack[pawn] = pawn_attacks_player(pos->map[pawn]);
+	else if (mcapturedp(m) == knight)
+		pos->attack[knight] = knight_attacks(pos->map[knight]);
+	pos->attack[bishop] = bishop_attacks(pos->map[bishop], pos);
+	pos->attack[rook] = rook_attacks(pos->map[rook], pos);
+	pos->attack[queen] = bishop_attacks(pos->map[queen], pos);
+	pos->attack[queen] |= rook_attacks(pos->map[queen], pos);
+	accumulate_attacks(pos->attack, pos->sliding_attacks);
+}
+
+static void
+update_opponent_attacks(struct position *pos, move m)
+{
+	if (mresultp(m) == pawn || is_promotion(m))
+		pos->attack[opponent_pawn] =
+		    pawn_attacks_opponent(pos->map[opponent_pawn]);
+	if (mresultp(m) == knight)
+		pos->attack[opponent_knight] =
+		    knight_attacks(pos->map[opponent_knight]);
+	else if (mresultp(m) == king)
+		pos->attack[opponent_king] = king_pattern[pos->opp_ki];
+	pos->attack[opponent_bishop] =
+	    bishop_attacks(pos->map[opponent_bishop], pos);
+	pos->attack[opponent_rook] =
+	    rook_attacks(pos->map[opponent_rook], pos);
+	pos->attack[opponent_queen] =
+	    bishop_attacks(pos->map[opponent_queen], pos);
+	pos->attack[opponent_queen] |=
+	    rook_attacks(pos->map[opponent_queen], pos);
+
+	accumulate_attacks(pos->attack + 1, pos->sliding_attacks + 1);
+}
+
 static void
 search_king_attacks(struct position *pos)
 {
@@ -513,7 +579,6 @@ position_reset(struct position *pos,
 		return -1;
 	if (!castle_rights_valid(pos))
 		return -1;
-	generate_all_rays(pos);
 	generate_player_attacks(pos);
 	generate_opponent_attacks(pos);
 	generate_pawn_reach_maps(pos);
@@ -532,7 +597,8 @@ position_reset(struct position *pos,
 struct position*
 position_allocate(void)
 {
-	struct position *pos = xaligned_alloc(pos_alignment, sizeof *pos);
+	struct position *pos =
+	    xaligned_alloc(alignof(struct position), sizeof *pos);
 	memset(pos, 0, sizeof *pos);
 	return pos;
 }
@@ -542,7 +608,8 @@ position_create(const char board[static 64],
 		const bool castle_rights[static 4],
 		int en_passant_index)
 {
-	struct position *pos = xaligned_alloc(pos_alignment, sizeof *pos);
+	struct position *pos =
+	    xaligned_alloc(alignof(struct position), sizeof *pos);
 	if (position_reset(pos, board, castle_rights, en_passant_index) == 0) {
 		return pos;
 	}
@@ -555,7 +622,8 @@ position_create(const char board[static 64],
 struct position*
 position_dup(const struct position *pos)
 {
-	struct position *new = xaligned_alloc(pos_alignment, sizeof *new);
+	struct position *new =
+	    xaligned_alloc(alignof(struct position), sizeof *new);
 
 	*new = *pos;
 	return new;
@@ -572,6 +640,8 @@ setup_zhash(struct position *pos)
 {
 	pos->zhash[0] = 0;
 	pos->zhash[1] = 0;
+	pos->pawn_zhash[0] = 0;
+	pos->pawn_zhash[1] = 0;
 	for (uint64_t occ = pos->occupied;
 	    is_nonempty(occ);
 	    occ = reset_lsb(occ)) {
@@ -579,6 +649,9 @@ setup_zhash(struct position *pos)
 		z2_toggle_sq(pos->zhash, i,
 		    pos_piece_at(pos, i),
 		    pos_player_at(pos, i));
+		if (pos_piece_at(pos, i) == pawn)
+			z2_toggle_sq(pos->pawn_zhash, i,
+			    pawn, pos_player_at(pos, i));
 	}
 	if (pos->cr_king_side)
 		z2_toggle_castle_king_side(pos->zhash);
@@ -619,10 +692,10 @@ kings_attacks_valid(const struct position *pos)
 	if (popcnt(pawn_attacks_player(k) & pos->map[opponent_pawn]) > 1)
 		return false;
 
-	if (popcnt(pos->rays[pr_bishop][pos->ki] & pos->bq[1]) > 1)
+	if (popcnt(bishop_reach(pos, pos->ki) & pos->bq[1]) > 1)
 		return false;
 
-	uint64_t rq_attackers = pos->rays[pr_rook][pos->ki] & pos->rq[1];
+	uint64_t rq_attackers = rook_reach(pos, pos->ki) & pos->rq[1];
 
 	if (popcnt(rq_attackers) > 2)
 		return false;
@@ -777,15 +850,15 @@ flip_piece_maps(struct position *restrict dst,
 }
 
 
-
 static void
-flip_all_rays(struct position *restrict dst, const struct position *restrict src)
+flip_attack_maps(struct position *restrict dst,
+		const struct position *restrict src)
 {
-	flip_ray_array(dst->rays[pr_bishop], src->rays[pr_bishop]);
-	flip_ray_array(dst->rays[pr_rook], src->rays[pr_rook]);
+	flip_2_bb_pairs(dst->attack + 2, src->attack + 2);
+	flip_2_bb_pairs(dst->attack + 6, src->attack + 6);
+	flip_2_bb_pairs(dst->attack + 10, src->attack + 10);
 }
 
-
 
 /*
  * flip_tail
@@ -897,6 +970,7 @@ clear_extra_bitboards(struct position *pos)
 
 	pos->king_attack_map = EMPTY;
 	pos->king_danger_map = EMPTY;
+	pos->lazy_move = 0;
 	pos->ep_index = 0;
 
 #endif
@@ -907,6 +981,7 @@ position_flip(struct position *restrict dst,
 		const struct position *restrict src)
 {
 	assert(!is_in_check(src));
+	assert(position_is_complete(src));
 
 	flip_chess_board(dst->board, src->board);
 	clear_extra_bitboards(dst);
@@ -915,13 +990,10 @@ position_flip(struct position *restrict dst,
 	dst->opp_ki = flip_i(src->ki);
 	dst->attack[0] = bswap(src->attack[1]);
 	dst->attack[1] = bswap(src->attack[0]);
-	flip_2_bb_pairs(dst->attack + 2, src->attack + 2);
-	flip_2_bb_pairs(dst->attack + 6, src->attack + 6);
-	flip_2_bb_pairs(dst->attack + 10, src->attack + 10);
+	flip_attack_maps(dst, src);
 	flip_2_bb_pairs(dst->sliding_attacks, src->sliding_attacks);
 	flip_piece_maps(dst, src);
 	flip_2_bb_pairs(dst->rq, src->rq);
-	flip_all_rays(dst, src);
 	flip_tail(dst, src);
 	flip_2_bb_pairs(dst->king_pins, src->king_pins);
 	dst->undefended[0] = bswap(src->undefended[1]);
@@ -930,6 +1002,8 @@ position_flip(struct position *restrict dst,
 	dst->all_knights = bswap(src->all_knights);
 	dst->all_rq = bswap(src->all_rq);
 	dst->all_bq = bswap(src->all_bq);
+	dst->pawn_zhash[0] = src->pawn_zhash[1];
+	dst->pawn_zhash[1] = src->pawn_zhash[0];
 	flip_chess_board(dst->hanging, src->hanging);
 	dst->hanging_map = bswap(src->hanging_map);
 }
@@ -998,6 +1072,28 @@ move_pawn(struct position *pos, move m)
 	}
 }
 
+/*
+ * Update the pawn hash key, with the move already flipped, i.e. the pawns
+ * of the player making the move are the opponent's pawns.
+ */
+static void
+update_pawn_zhash(struct position *restrict dst,
+		const struct position *restrict src,
+		move m)
+{
+	dst->pawn_zhash[0] = src->pawn_zhash[1];
+	dst->pawn_zhash[1] = src->pawn_zhash[0];
+
+	if (mresultp(m) == pawn || is_promotion(m))
+		z2_toggle_sq(dst->pawn_zhash, mfrom(m), pawn, 1);
+	if (mresultp(m) == pawn)
+		z2_toggle_sq(dst->pawn_zhash, mto(m), pawn, 1);
+	if (mtype(m) == mt_en_passant)
+		z2_toggle_sq(dst->pawn_zhash, mto(m) + NORTH, pawn, 0);
+	else if (mcapturedp(m) == pawn)
+		z2_toggle_sq(dst->pawn_zhash, mto(m), pawn, 0);
+}
+
 static void
 move_piece(struct position *pos, move m)
 {
@@ -1035,19 +1131,19 @@ move_piece(struct position *pos, move m)
 }
 
 void
-make_move(struct position *restrict dst,
+make_move_lazy(struct position *restrict dst,
 		const struct position *restrict src,
 		move m)
 {
+	assert(position_is_complete(src));
+
 	m = flip_m(m);
 	flip_chess_board(dst->board, src->board);
 	flip_piece_maps(dst, src);
+	flip_attack_maps(dst, src);
 	clear_extra_bitboards(dst);
-	flip_all_rays(dst, src);
 	flip_tail(dst, src);
 
-	update_all_rays(dst, m);
-
 	invariant(value_bounds(dst->material_value));
 	invariant(value_bounds(dst->opponent_material_value));
 	clear_to_square(dst, mto(m));
@@ -1068,13 +1164,35 @@ make_move(struct position *restrict dst,
 		generate_pawn_reach_maps(dst);
 	accumulate_occupancy(dst);
 	search_king_attacks(dst);
-	search_pins(dst);
-	generate_player_attacks(dst);
-	generate_opponent_attacks(dst);
-	accumulate_misc_patterns(dst, 0);
-	accumulate_misc_patterns(dst, 1);
 	z2_xor_move(dst->zhash, m);
-	find_hanging_pieces(dst);
+	update_pawn_zhash(dst, src, m);
+	dst->lazy_move = m;
+}
+
+void
+position_complete(struct position *pos)
+{
+	if (position_is_complete(pos))
+		return;
+
+	move m = (move)pos->lazy_move;
+
+	search_pins(pos);
+	update_player_attacks(pos, m);
+	update_opponent_attacks(pos, m);
+	accumulate_misc_patterns(pos, 0);
+	accumulate_misc_patterns(pos, 1);
+	find_hanging_pieces(pos);
+	pos->lazy_move = 0;
+}
+
+void
+make_move(struct position *restrict dst,
+		const struct position *restrict src,
+		move m)
+{
+	make_move_lazy(dst, src, m);
+	position_complete(dst);
 }
 
 void
@@ -88,7 +88,12 @@ struct position {
 	uint64_t king_attack_map;
 	uint64_t king_danger_map;
 
-	uint64_t padding;
+	/*
+	 * The move that lead to this position, if it was made using
+	 * make_move_lazy, and the position is not completed yet, zero
+	 * otherwise. See position_complete.
+	 */
+	uint64_t lazy_move;
 
 	/*
 	 * Index of a pawn that can be captured en passant.
@@ -174,9 +179,6 @@ struct position {
 	uint64_t rq[2]; // map[rook] | map[queen]
 	uint64_t bq[2]; // map[bishop] | map[queen]
 
-	alignas(pos_alignment)
-	uint64_t rays[2][64];
-
 	alignas(pos_alignment)
 	/*
 	 * The following four 64 bit contain two symmetric pairs, that can be
@@ -228,6 +230,14 @@ struct position {
 	uint64_t all_rq;
 	uint64_t all_bq;
 
+	/*
+	 * Zobrist hash key of the pawns only, used for indexing the pawn
+	 * structure cache in eval.c. Just as zhash, pawn_zhash[0] is from the
+	 * point of view of the player to move, pawn_zhash[1] is from the
+	 * opponent's point of view.
+	 */
+	uint64_t pawn_zhash[2];
+
 	alignas(64)
 	uint8_t hanging[64];
 	uint64_t hanging_map;
@@ -243,11 +253,40 @@ static_assert(offsetof(struct position, opponent_material_value) +
 	offsetof(struct position, zhash) == 32,
 	"struct position layout error");
 
-enum position_ray_directions {
-	pr_bishop,
-	pr_rook,
+/*
+ * Lookup tables of sliding piece attacks, indexed by square, and the
+ * relevant occupancy around the square. The index is computed using
+ * PEXT where available, using fancy magic bitboards otherwise.
+ */
+struct slider_magic {
+	uint64_t mask;
+#ifndef TALTOS_CAN_USE_INTEL_PDEP_PEXT_64
+	uint64_t magic;
+	unsigned shift;
+#endif
+	const uint64_t *attacks;
 };
 
+extern struct slider_magic bishop_magics[64];
+extern struct slider_magic rook_magics[64];
+
+void init_slider_attacks(void);
+
+static inline uint64_t
+slider_index(const struct slider_magic *m, uint64_t occupied)
+{
+#ifdef TALTOS_CAN_USE_INTEL_PDEP_PEXT_64
+	return pext(occupied, m->mask);
+#else
+	return ((occupied & m->mask) * m->magic) >> m->shift;
+#endif
+}
+
+static inline uint64_t
+slider_attacks(const struct slider_magic *m, uint64_t occupied)
+{
+	return m->attacks[slider_index(m, occupied)];
+}
 
 
 static inline enum piece
@@ -275,14 +314,14 @@ static inline uint64_t
 bishop_reach(const struct position *p, int i)
 {
 	invariant(ivalid(i));
-	return p->rays[pr_bishop][i];
+	return slider_attacks(bishop_magics + i, p->occupied);
 }
 
 static inline uint64_t
 rook_reach(const struct position *p, int i)
 {
 	invariant(ivalid(i));
-	return p->rays[pr_rook][i];
+	return slider_attacks(rook_magics + i, p->occupied);
 }
 
 static inline uint64_t
@@ -453,9 +492,39 @@ has_insufficient_material(const struct position *p)
 	return false;
 }
 
+/*
+ * Copy-make: the position resulting from the move is written to dst, while
+ * src is left intact, thus there is no unmake. A position is always seen
+ * from the point of view of the player to move, so every move flips the
+ * whole position - making a move in place, and undoing it would flip it
+ * twice, and an undo record would need to hold most of the attack maps.
+ */
 void make_move(struct position *restrict dst,
 		const struct position *restrict src,
 		move)
 	attribute(nonnull);
 
+/*
+ * make_move_lazy computes only the board, the piece maps, the hash keys,
+ * the castling rights, material values, and the king attack maps - thus
+ * is_in_check can be used on the resulting position.
+ * The rest of the attack maps, pins, undefended and hanging pieces are
+ * only computed later in position_complete, which must be called before
+ * generating moves, evaluating the position, or making a move from it.
+ * Nodes cut off before any of those never pay for the attack maps.
+ */
+void make_move_lazy(struct position *restrict dst,
+		const struct position *restrict src,
+		move)
+	attribute(nonnull);
+
+void position_complete(struct position*)
+	attribute(nonnull);
+
+static inline bool
+position_is_complete(const struct position *p)
+{
+	return p->lazy_move == 0;
+}
+
 #endif
@@ -59,8 +59,10 @@ struct nodes_common_data {
 	struct search_description sd;
 
 	enum player debug_root_player_to_move;
+#ifndef NDEBUG
 	char debug_move_stack[0x10000];
 	char *debug_move_stack_end;
+#endif
 };
 
 struct node {
@@ -97,15 +99,25 @@ struct node {
 
 	enum player debug_player_to_move;
 
-	move pv[MAX_PLY];
+	/*
+	 * The principal variation found at this node, terminated by a zero.
+	 * Points into an array shared by all nodes, see pv_capacity.
+	 */
+	move *pv;
+	unsigned pv_capacity;
 	move forced_pv;
-	move forced_extension;
 
 	int repetition_affected_best;
 	int repetition_affected_any;
 
 	bool is_in_null_move_search;
 	bool null_move_search_failed;
+
+	/*
+	 * The hash move, if it was found to be singular, searched one ply
+	 * deeper than the other moves.
+	 */
+	move singular_move;
 };
 
 static void
@@ -256,11 +268,44 @@ handle_node_types(struct node *node)
 	}
 }
 
+/*
+ * A small lossy cache of static evaluations, private to each search
+ * thread. The same position is often evaluated repeatedly, via
+ * transpositions, or re-searches after a null move or LMR search.
+ * Each entry holds the upper bits of the hash key, and the value in
+ * the lowest 16 bits.
+ */
+
+#ifndef EVAL_CACHE_SIZE_LOG2
+#define EVAL_CACHE_SIZE_LOG2 14
+#endif
+
+static_assert(max_value <= INT16_MAX, "eval cache entry can't hold value");
+
+static _Thread_local uint64_t eval_cache[1u << EVAL_CACHE_SIZE_LOG2];
+
+static int
+cached_eval(struct position *pos)
+{
+	uint64_t key = pos->zhash[0];
+	uint64_t *entry =
+	    eval_cache + (key & ((1u << EVAL_CACHE_SIZE_LOG2) - 1));
+
+	if ((*entry & ~UINT64_C(0xffff)) == (key & ~UINT64_C(0xffff)))
+		return (int16_t)(uint16_t)*entry;
+
+	position_complete(pos);
+	int value = eval(pos);
+	*entry = (key & ~UINT64_C(0xffff)) | (uint16_t)value;
+
+	return value;
+}
+
 static int
 get_static_value(struct node *node)
 {
 	if (!node->static_value_computed) {
-		node->static_value = eval(node->pos);
+		node->static_value = cached_eval(node->pos);
 		node->static_value_computed = true;
 	}
 
@@ -318,11 +363,15 @@ fail_high(struct node *node)
 		if (node->mo->picked_count == 1)
 			node->common->result.first_move_cutoff_count++;
 	}
-	if (mo_current_move_value(node->mo) < killer_value)
+	if (mo_current_move_value(node->mo) < killer_value) {
 		move_order_add_killer(node->mo, node->best_move);
+		move_order_add_counter_move(node->mo, node->best_move);
+	}
 
 	if (node->depth > 2 * PLY)
 		move_order_adjust_history_on_cutoff(node->mo);
+
+	move_order_adjust_capture_history_on_cutoff(node->mo);
 }
 
 
@@ -366,6 +415,7 @@ node_init(struct node *node)
 
 	node->is_in_null_move_search = false;
 	node->null_move_search_failed = false;
+	node->singular_move = 0;
 	node->repetition_affected_any = 0;
 	node->repetition_affected_best = 0;
 	node->non_pawn_move_count = 0;
@@ -558,6 +608,40 @@ try_null_move_prune(struct node *node)
 	return 0;
 }
 
+/*
+ * Reverse futility pruning, also known as static null move pruning: near
+ * the leaves, a static evaluation exceeding beta by a large enough margin
+ * is trusted to mean a fail high, without searching any move.
+ */
+static int
+try_reverse_futility_prune(struct node *node)
+{
+	const struct search_settings *settings = &node->common->sd.settings;
+
+	if (!settings->use_reverse_futility_pruning)
+		return 0;
+
+	if ((node->root_distance == 0)
+	    || (node->forced_pv != 0)
+	    || (node->expected_type == PV_node)
+	    || is_qsearch(node)
+	    || (node->depth < PLY)
+	    || (node->depth > 3 * PLY)
+	    || (node->beta >= mate_value)
+	    || (node->beta <= -mate_value)
+	    || is_in_check(node->pos))
+		return 0;
+
+	int margin = settings->reverse_futility_margins[node->depth / PLY];
+
+	if (get_static_value(node) - margin >= node->beta) {
+		node->value = node->beta;
+		return prune_successfull;
+	}
+
+	return 0;
+}
+
 enum { hash_cutoff = 1 };
 
 static int
@@ -603,9 +687,11 @@ check_hash_value(struct node *node, ht_entry entry)
 	if (node->root_distance == 0)
 		return 0;
 
-	if (node[-1].forced_pv != 0
-	    && node->alpha == -max_value
-	    && node->beta == max_value)
+	/*
+	 * No cutoffs at PV nodes: the PV is collected from the child nodes
+	 * in new_best_move, and a hash table hit would end it right here.
+	 */
+	if (node->expected_type == PV_node && node->alpha + 1 < node->beta)
 		return 0;
 
 	if (node->depth > ht_depth(entry)) {
@@ -668,8 +754,6 @@ adjust_depth(struct node *node)
 	if (node->root_distance == 0)
 		return 0;
 
-	node->depth += node->forced_extension;
-
 	if (node->root_distance >= node_array_length - 1) {
 		// search space exploding exponentially?
 		// forced static eval, cut tree at this depth
@@ -683,32 +767,28 @@ adjust_depth(struct node *node)
 	return 0;
 }
 
+/*
+ * The hash table is probed before generating any moves, thus a cutoff
+ * based on a hash value avoids the cost of move generation, and of
+ * computing the rest of the position. The entries are only remembered
+ * here, the moves found in them are added to move ordering later by
+ * add_hash_moves.
+ */
 static int
 fetch_hash_value(struct node *node)
 {
 	ht_entry entry = ht_lookup_deep(node->tt, node->pos,
 	    node->depth, node->beta);
 	if (ht_is_set(entry)) {
-		if (move_order_add_hint(node->mo, ht_move(entry), 1) == 0) {
-			node->deep_entry = entry;
-			if (check_hash_value(node, entry) == hash_cutoff)
-				return hash_cutoff;
-		}
+		node->deep_entry = entry;
+		if (check_hash_value(node, entry) == hash_cutoff)
+			return hash_cutoff;
 	}
 
 	entry = ht_lookup_fresh(node->tt, node->pos);
 	if (!ht_is_set(entry))
 		return 0;
 
-	if (ht_has_move(node->deep_entry)) {
-		if (move_order_add_weak_hint(node->mo, ht_move(entry)) != 0)
-			return 0;
-	}
-	else {
-		if (move_order_add_hint(node->mo, ht_move(entry), 1) != 0)
-			return 0;
-	}
-
 	node->fresh_entry = entry;
 	if (check_hash_value(node, entry) == hash_cutoff) {
 		ht_pos_insert(node->tt, node->pos, entry);
@@ -718,14 +798,76 @@ fetch_hash_value(struct node *node)
 	return 0;
 }
 
+/*
+ * A move found in the hash table is not necessarily among the moves
+ * generated, e.g. a quiet move in quiescence search. Such a move is
+ * forgotten, so it is not used later as the best move either.
+ */
+static void
+add_hash_moves(struct node *node)
+{
+	if (ht_has_move(node->deep_entry)) {
+		if (move_order_add_hint(node->mo,
+		    ht_move(node->deep_entry), 1) != 0)
+			node->deep_entry = ht_set_no_move(node->deep_entry);
+	}
+
+	if (!ht_has_move(node->fresh_entry))
+		return;
+
+	int r;
+	if (ht_has_move(node->deep_entry))
+		r = move_order_add_weak_hint(node->mo,
+		    ht_move(node->fresh_entry));
+	else
+		r = move_order_add_hint(node->mo,
+		    ht_move(node->fresh_entry), 1);
+
+	if (r != 0)
+		node->fresh_entry = ht_set_no_move(node->fresh_entry);
+}
+
+/*
+ * The move made the given number of plies before reaching the node,
+ * or zero if there is no such move, i.e. a null move, or the root node
+ * was reached.
+ */
+static move
+previous_move(const struct node *node, unsigned plies)
+{
+	if (node->root_distance < plies)
+		return 0;
+
+	const struct node *parent = node - plies;
+	if (parent->is_in_null_move_search)
+		return 0;
+
+	return mo_current_move(parent->mo);
+}
+
 enum { no_legal_moves = 1 };
 
 static int
 setup_moves(struct node *node)
 {
+	position_complete(node->pos);
 	move_order_setup(node->mo, node->pos,
 	    is_qsearch(node), node->root_distance % 2);
 
+	node->mo->history = node->common->sd.move_history;
+	node->mo->previous_moves[0] = previous_move(node, 1);
+	node->mo->previous_moves[1] = previous_move(node, 2);
+
+	const struct search_settings *settings = &node->common->sd.settings;
+	if (!is_qsearch(node)
+	    && node->depth <= settings->cheap_move_order_depth)
+		node->mo->cheap_scoring_index = 0;
+	else
+		node->mo->cheap_scoring_index = settings->cheap_move_order_index;
+
+	node->mo->lower_SEE_losing_captures =
+	    is_qsearch(node) && settings->use_qsearch_pruning;
+
 	if (node->mo->count == 0) {
 		if (is_qsearch(node))
 			node->value = node->lower_bound;  // leaf node
@@ -800,6 +942,61 @@ can_prune_moves(const struct node *node)
 	return false;
 }
 
+/*
+ * Futility pruning: near the leaves, a quiet move is not searched if
+ * the static evaluation plus a margin can't reach alpha, as long as the
+ * move does not give check. The first move is always searched.
+ */
+static bool
+is_futile_move(struct node *node, move m)
+{
+	const struct search_settings *settings = &node->common->sd.settings;
+
+	if (!settings->use_futility_pruning)
+		return false;
+
+	if ((node->expected_type == PV_node)
+	    || is_qsearch(node)
+	    || (node->depth < PLY)
+	    || (node->depth > 3 * PLY)
+	    || (node->mo->picked_count < 2)
+	    || (node->alpha <= -mate_value)
+	    || (node->alpha >= mate_value)
+	    || is_capture(m)
+	    || is_promotion(m)
+	    || is_in_check(node->pos)
+	    || is_in_check(node[1].pos))
+		return false;
+
+	int margin = settings->futility_margins[node->depth / PLY];
+
+	return get_static_value(node) + margin <= node->alpha;
+}
+
+enum { delta_pruning_margin = 200 };
+
+/*
+ * Delta pruning: in quiescence search, a capture is not searched if even
+ * winning the captured piece, plus a margin, would not raise the stand
+ * pat value above alpha.
+ */
+static bool
+is_delta_prunable(struct node *node, move m)
+{
+	if (!node->common->sd.settings.use_qsearch_pruning)
+		return false;
+
+	if (!is_qsearch(node)
+	    || is_promotion(m)
+	    || is_in_check(node->pos)
+	    || (node->alpha >= mate_value))
+		return false;
+
+	int gain = piece_value[mcapturedp(m)] + delta_pruning_margin;
+
+	return get_static_value(node) + gain <= node->alpha;
+}
+
 enum { stand_pat_cutoff = 1 };
 
 static int
@@ -860,6 +1057,40 @@ recheck_bounds(struct node *node)
 	return 0;
 }
 
+/*
+ * Counts the occurences of the node's position in the game before the
+ * root. Only relevant when the node can be reached from the root without
+ * irreversible moves.
+ */
+static unsigned
+game_history_repetition_count(const struct node *node)
+{
+	const struct search_description *sd = &node->common->sd;
+	const uint64_t *zhash = node->pos->zhash;
+	unsigned count = 0;
+
+	if (node->root_distance == 0 || sd->game_history_length == 0)
+		return 0;
+
+	for (const struct node *n = node; n->root_distance > 0; --n) {
+		if (n->is_GHI_barrier)
+			return 0;
+	}
+
+	/*
+	 * The first entry in game history is one ply before the root,
+	 * only every second entry has the same player to move as the node.
+	 */
+	unsigned i = (node->root_distance % 2 == 0) ? 1 : 0;
+	for (; i < sd->game_history_length; i += 2) {
+		if (sd->game_history[i][0] == zhash[0]
+		    && sd->game_history[i][1] == zhash[1])
+			++count;
+	}
+
+	return count;
+}
+
 static int
 find_repetition(struct node *node)
 {
@@ -888,6 +1119,18 @@ find_repetition(struct node *node)
 		}
 	}
 
+	/*
+	 * A position repeated in the search tree is considered a draw, but
+	 * a position from the game before the root must occur for the third
+	 * time to be a draw. The value found this way depends on the path
+	 * all the way to the root.
+	 */
+	unsigned game_count = game_history_repetition_count(node);
+	if (strict && game_count > 0)
+		node->has_repetition_in_history = true;
+	if (game_count + (found_first != 0 ? 1 : 0) >= 2)
+		return node->root_distance;
+
 	return 0;
 }
 
@@ -912,8 +1155,24 @@ check_trivial_draw(struct node *node)
 	return 0;
 }
 
+/*
+ * Principal variation search: at a PV node, the first move is searched
+ * with the full window, and expected to remain the best move. All other
+ * moves are searched with a zero window, just to prove they are not
+ * better than the one found so far. Only if such a move turns out to be
+ * better, it is searched again with the full window, to find its value.
+ * Moves reduced by LMR are re-searched with the full window directly.
+ */
+static bool
+is_zero_window_search(const struct node *node)
+{
+	return node->expected_type == PV_node
+	    && node->mo->picked_count > 1
+	    && node->alpha + 1 < node->beta;
+}
+
 static void
-setup_child_node(struct node *node, move m, int *LMR_factor)
+make_child_move(struct node *node, move m)
 {
 	struct node *child = node + 1;
 
@@ -929,11 +1188,21 @@ setup_child_node(struct node *node, move m, int *LMR_factor)
 		}
 	}
 
-	make_move(child->pos, node->pos, m);
+	make_move_lazy(child->pos, node->pos, m);
 	debug_trace_tree_push_move(node, m);
+}
+
+static void
+setup_child_node(struct node *node, move m, int *LMR_factor)
+{
+	struct node *child = node + 1;
+
+	make_child_move(node, m);
 	handle_node_types(node);
 
 	child->depth = node->depth - PLY;
+	if (m == node->singular_move)
+		child->depth += PLY;
 	child->beta = -node->alpha;
 	child->alpha = -node->beta;
 
@@ -943,6 +1212,9 @@ setup_child_node(struct node *node, move m, int *LMR_factor)
 		child->depth -= *LMR_factor;
 		child->alpha = -node->alpha - 1;
 	}
+	else if (is_zero_window_search(node)) {
+		child->alpha = -node->alpha - 1;
+	}
 }
 
 static void
@@ -951,6 +1223,80 @@ reset_child_after_lmr(struct node *node)
 	node[1].depth = node->depth - PLY;
 	node[1].alpha = -node->beta;
 	node[1].beta = -node->alpha;
+	if (node[1].alpha + 1 < node[1].beta)
+		node[1].expected_type = PV_node;
+}
+
+static void
+reset_child_after_zero_window(struct node *node)
+{
+	node[1].alpha = -node->beta;
+	node[1].beta = -node->alpha;
+	node[1].expected_type = PV_node;
+}
+
+/*
+ * Singular extensions: when the deep hash entry holds a lower bound found
+ * with the hash move, at a depth not much smaller than the depth of the
+ * node, all other moves are searched with a reduced depth, and a zero
+ * window somewhat below that bound. If none of them reaches it, the hash
+ * move is considered singular - the only good move in the position - and
+ * is searched one ply deeper. The move order is rewound afterwards, as
+ * if the other moves were never picked.
+ * Not tried in the positions where null move pruning is not tried either
+ * for fear of zugzwang, i.e. when only the king and the pawns can move:
+ * there the verification searches mostly reiterate the few king moves,
+ * and slow down finding the deep king maneuvers of such endgames.
+ */
+static void
+try_singular_extension(struct node *node)
+{
+	const struct search_settings *settings = &node->common->sd.settings;
+	ht_entry entry = node->deep_entry;
+
+	if (!settings->use_singular_extensions)
+		return;
+
+	if ((node->root_distance == 0)
+	    || (node->non_pawn_move_piece_count < 2)
+	    || (node->depth < settings->singular_extension_depth)
+	    || !ht_has_move(entry)
+	    || !ht_value_is_lower_bound(entry)
+	    || (ht_depth(entry) < node->depth - 3 * PLY)
+	    || (ht_value(entry) >= mate_value)
+	    || (ht_value(entry) <= -mate_value))
+		return;
+
+	move hash_move = ht_move(entry);
+	int margin = settings->singular_extension_margin * node->depth / PLY;
+	int singular_beta = ht_value(entry) - margin;
+	struct move_order_mark mark = move_order_mark(node->mo);
+	bool is_singular = true;
+
+	while (!move_order_done(node->mo)) {
+		move_order_pick_next(node->mo);
+		move m = mo_current_move(node->mo);
+		if (m == hash_move)
+			continue;
+
+		make_child_move(node, m);
+		node[1].expected_type = cut_node;
+		node[1].depth = node->depth / 2 - PLY;
+		node[1].alpha = -singular_beta;
+		node[1].beta = -singular_beta + 1;
+		int value = negamax_child(node);
+		debug_trace_tree_pop_move(node);
+
+		if (value >= singular_beta) {
+			is_singular = false;
+			break;
+		}
+	}
+
+	move_order_rewind(node->mo, mark);
+
+	if (is_singular)
+		node->singular_move = hash_move;
 }
 
 enum { mate_search_handled = 1 };
@@ -963,6 +1309,7 @@ is_checkmate(struct node *node)
 	if (!is_in_check(node->pos))
 		return false;
 
+	position_complete(node->pos);
 	return gen_moves(node->pos, node->mo->moves) == 0;
 }
 
@@ -1010,11 +1357,12 @@ new_best_move(struct node *node, move best)
 
 	if (node->alpha < node->beta) {
 		node->pv[0] = best;
-		unsigned i = 0;
-		do {
-			node->pv[i + 1] = node[1].pv[i];
+		unsigned i = 1;
+		while (i + 1 < node->pv_capacity && node[1].pv[i - 1] != 0) {
+			node->pv[i] = node[1].pv[i - 1];
 			++i;
-		} while (node->pv[i] != 0);
+		}
+		node->pv[i] = 0;
 	}
 }
 
@@ -1066,12 +1414,16 @@ negamax(struct node *node)
 	if (setup_bounds(node) == stand_pat_cutoff)
 		return;
 
+	if (node->forced_pv == 0) {
+		if (fetch_hash_value(node) == hash_cutoff)
+			return;
+	}
+
 	if (setup_moves(node) == no_legal_moves)
 		return;
 
 	if (node->forced_pv == 0) {
-		if (fetch_hash_value(node) == hash_cutoff)
-			return;
+		add_hash_moves(node);
 	}
 	else {
 		int r = move_order_add_hint(node->mo, node->forced_pv, 0);
@@ -1079,12 +1431,17 @@ negamax(struct node *node)
 		assert(r == 0);
 	}
 
+	if (try_reverse_futility_prune(node) == prune_successfull)
+		return;
+
 	if (try_null_move_prune(node) == prune_successfull)
 		return;
 
 	if (recheck_bounds(node) == alpha_beta_range_too_small)
 		return;
 
+	try_singular_extension(node);
+
 	assert(node->beta > -max_value + 2);
 	assert(node->alpha < max_value - 2);
 
@@ -1096,10 +1453,18 @@ negamax(struct node *node)
 
 		move m = mo_current_move(node->mo);
 
+		if (is_delta_prunable(node, m))
+			continue;
+
 		int LMR_factor;
 
 		setup_child_node(node, m, &LMR_factor);
 
+		if (is_futile_move(node, m)) {
+			debug_trace_tree_pop_move(node);
+			continue;
+		}
+
 		int value = negamax_child(node);
 
 		if (LMR_factor != 0) {
@@ -1112,6 +1477,11 @@ negamax(struct node *node)
 				continue;
 			}
 		}
+		else if (value > node->alpha && value < node->beta
+		    && is_zero_window_search(node)) {
+			reset_child_after_zero_window(node);
+			value = negamax_child(node);
+		}
 
 		value = handle_beta_extension(node, m, value);
 
@@ -1151,12 +1521,47 @@ negamax(struct node *node)
 
 
 
+/*
+ * The principal variation of a node can not be longer than the PV of its
+ * parent, minus one move. Instead of an array of MAX_PLY moves in each
+ * node - most of it never used, but making each node larger - the nodes
+ * use slices of a single array, of decreasing length. Nodes deeper than
+ * MAX_PLY, reachable in quiescence search, only have room for a best move,
+ * and the terminating zero.
+ */
+static unsigned
+pv_capacity(unsigned index)
+{
+	if (index == 0 || index + 2 > MAX_PLY)
+		return 2;
+	else
+		return MAX_PLY + 1 - index;
+}
+
+static size_t
+pv_array_length(size_t node_count)
+{
+	size_t length = 0;
+
+	for (unsigned i = 0; i < node_count; ++i)
+		length += pv_capacity(i);
+
+	return length;
+}
+
 static void
 setup_node_array(size_t count, struct node nodes[count],
+		move *pv_array,
 		struct search_description sd,
 		struct nodes_common_data *common,
 		const move *prev_pv)
 {
+	for (unsigned i = 0; i < count; ++i) {
+		nodes[i].pv = pv_array;
+		nodes[i].pv_capacity = pv_capacity(i);
+		pv_array += nodes[i].pv_capacity;
+	}
+
 	for (unsigned i = 1; i < count; ++i) {
 		nodes[i].root_distance = i - 1;
 		nodes[i].tt = sd.tt;
@@ -1209,141 +1614,90 @@ find_qdepth(const struct node nodes[])
 	return depth - 2;
 }
 
-struct pv_store {
-	move pvs[100][MAX_PLY];
-	unsigned count;
-};
-
-static bool
-has_same_pv_in_pv_store(const struct pv_store *pv_store, const move *pv)
-{
-	for (unsigned pv_i = 0; pv_i < pv_store->count; ++pv_i) {
-		const move *p0 = pv_store->pvs[pv_i];
-		const move *p1 = pv;
-
-		while (*p0 != 0 && *p0 == *p1) {
-			++p0;
-			++p1;
-		}
-
-		if (*p0 == 0 && *p1 == 0)
-			return true;
-	}
-
-	return false;
-}
-
-static int
-find_common_prefix_length(const struct pv_store *pv_store)
-{
-	int length = 0;
-
-	while (pv_store->pvs[0][length] != 0) {
-		for (unsigned i = 1; i < pv_store->count; ++i) {
-			if (pv_store->pvs[i][length]
-			    != pv_store->pvs[0][length])
-				return length;
-		}
-		++length;
-	}
-
-	return length;
-}
-
 static void
-extract_pv(struct pv_store *pv_store,
-		struct search_result *result, struct node *root)
+extract_pv(struct search_result *result, const struct node *root)
 {
 	int pv_len = 0;
-	int iteration = 0;
-
-#ifndef NDEBUG
-	char debug_move_stack[0x1000];
-	char *c;
-#endif
-
-	int extension_location = -1;
-next_iteration:
-
-	pv_len = 0;
-
-#ifndef NDEBUG
-	c = debug_move_stack;
-#endif
 
 	while (root->pv[pv_len] != 0) {
-#ifndef NDEBUG
-		*c++ = ' ';
-		c = print_coor_move(root->pv[pv_len], c,
-		    ((pv_len % 2)
-		    ? opponent_of(root->debug_player_to_move)
-		    : (int)root->debug_player_to_move));
-#endif
 		result->pv[pv_len] = root->pv[pv_len];
-		root[pv_len].forced_pv = root->pv[pv_len];
-		pv_store->pvs[pv_store->count][pv_len] = root->pv[pv_len];
 		++pv_len;
 	}
 
 	result->pv[pv_len] = 0;
+}
 
-	if (!root->common->sd.settings.use_pv_cleanup)
-		return;
-
-	pv_store->pvs[pv_store->count][pv_len] = 0;
-
-	if (++iteration > 98)
-		return;
-
-	if (root->depth < 3 * PLY)
-		return;
-
-	if (pv_len == 0)
-		return;
-
-	if (has_same_pv_in_pv_store(pv_store, root->pv)) {
-		if (extension_location == 1)
-			return;
+enum {
+	aspiration_window = 30,
+	aspiration_window_max = 400
+};
 
-		if (extension_location != -1)
-			root[extension_location].forced_extension = 0;
+/*
+ * From depth 5 on, the root is searched with a narrow window around the
+ * value found by the previous iteration. When the value falls outside
+ * the window, the bound it failed at is moved away, and the root is
+ * searched again. The distance of the moved bound from the previous
+ * value doubles with each failure, until it reaches
+ * aspiration_window_max, and the bound is dropped.
+ */
+static void
+search_root(struct node *root)
+{
+	const struct search_description *sd = &root->common->sd;
+	int alpha = -max_value;
+	int beta = max_value;
+	int alpha_delta = aspiration_window;
+	int beta_delta = aspiration_window;
+
+	if (sd->settings.use_aspiration_windows
+	    && sd->is_previous_value_valid
+	    && sd->depth >= 5 * PLY
+	    && sd->previous_value > -mate_value
+	    && sd->previous_value < mate_value) {
+		alpha = sd->previous_value - alpha_delta;
+		beta = sd->previous_value + beta_delta;
+	}
 
-		int new_ext = find_common_prefix_length(pv_store) - 1;
-		if (new_ext < 1)
+	while (true) {
+		root->alpha = alpha;
+		root->beta = beta;
+		root->expected_type = PV_node;
+		negamax(root);
+
+		if (root->value <= alpha && alpha > -max_value) {
+			alpha_delta *= 2;
+			if (alpha_delta > aspiration_window_max)
+				alpha = -max_value;
+			else
+				alpha = sd->previous_value - alpha_delta;
+		}
+		else if (root->value >= beta && beta < max_value) {
+			beta_delta *= 2;
+			if (beta_delta > aspiration_window_max)
+				beta = max_value;
+			else
+				beta = sd->previous_value + beta_delta;
+		}
+		else {
 			return;
+		}
 
-		if (extension_location == -1 || new_ext < extension_location)
-			extension_location = new_ext;
-		else
-			--extension_location;
-		root[extension_location].forced_extension = 1;
-
-		pv_store->pvs[0][0] = root->best_move;
-		pv_store->pvs[0][1] = 0;
-		pv_store->count = 1;
-		goto next_iteration;
+		root->common->result.aspiration_research_count++;
 	}
+}
 
-	pv_store->count++;
-
-	for (int i = pv_len; i < node_array_length - 1; ++i)
-		root[i].forced_pv = 0;
-
-	if (root->value == 0)
-		return;
-
-	if (root->value <= -mate_value || root->value >= mate_value)
-		return;
-
-	if (pv_len >= root->depth / PLY - 1)
-		return;
-
-	root->alpha = -max_value;
-	root->beta = max_value;
-	root->expected_type = PV_node;
-	negamax(root);
-
-	goto next_iteration;
+static void
+subtract_move_order_stats(struct move_order_stats *dst,
+			const struct move_order_stats a,
+			const struct move_order_stats b)
+{
+	for (unsigned i = 0; i < mo_stage_count; ++i) {
+		dst->stage_runs[i] = a.stage_runs[i] - b.stage_runs[i];
+		dst->stage_moves[i] = a.stage_moves[i] - b.stage_moves[i];
+		dst->stage_nanoseconds[i] =
+		    a.stage_nanoseconds[i] - b.stage_nanoseconds[i];
+	}
+	dst->cheap_scored_moves = a.cheap_scored_moves - b.cheap_scored_moves;
 }
 
 struct search_result
@@ -1354,25 +1708,33 @@ search(const struct position *root_pos,
 	const move *prev_pv)
 {
 	struct node *nodes;
+	move *pv_array;
 	struct nodes_common_data common;
 	struct node *root_node;
-	struct pv_store *pv_store;
+	struct pawn_cache_stats pawn_stats = eval_pawn_cache_stats();
+	struct move_order_stats mo_stats = move_order_stats();
+
+	if (sd.settings.use_move_order_timing)
+		move_order_enable_timing();
+	else
+		move_order_disable_timing();
 
-	pv_store = xmalloc(sizeof(*pv_store));
-	pv_store->count = 0;
 
-	nodes = xaligned_calloc(pos_alignment,
+	nodes = xaligned_calloc(alignof(struct node),
 	    sizeof(nodes[0]), node_array_length);
+	pv_array = xcalloc(pv_array_length(node_array_length),
+	    sizeof(pv_array[0]));
 	memset(&common, 0, sizeof common);
 	common.run_flag = run_flag;
 	common.sd = sd;
 	common.debug_root_player_to_move = debug_player_to_move;
-	setup_node_array(node_array_length, nodes, sd, &common, prev_pv);
+	setup_node_array(node_array_length, nodes, pv_array,
+	    sd, &common, prev_pv);
 	root_node = setup_root_node(nodes, root_pos);
 
 	if (setjmp(common.terminate_jmp_buf) == 0) {
-		negamax(root_node);
-		extract_pv(pv_store, &common.result, root_node);
+		search_root(root_node);
+		extract_pv(&common.result, root_node);
 		common.result.value = root_node->value;
 		common.result.best_move = root_node->best_move;
 		common.result.selective_depth = find_selective_depth(nodes);
@@ -1382,8 +1744,15 @@ search(const struct position *root_pos,
 		common.result.is_terminated = true;
 	}
 
+	common.result.pawn_cache_probes =
+	    eval_pawn_cache_stats().probes - pawn_stats.probes;
+	common.result.pawn_cache_hits =
+	    eval_pawn_cache_stats().hits - pawn_stats.hits;
+	subtract_move_order_stats(&common.result.move_order_stats,
+	    move_order_stats(), mo_stats);
+
+	free(pv_array);
 	xaligned_free(nodes);
-	free(pv_store);
 	return common.result;
 }
 
@@ -34,31 +34,47 @@
 #include "chess.h"
 #include "position.h"
 #include "hash.h"
+#include "move_order.h"
 #include "util.h"
 #include "taltos.h"
 
 #ifndef MAX_THREAD_COUNT
-// single thread for now...
-#define MAX_THREAD_COUNT 1
+#define MAX_THREAD_COUNT 64
 #endif
 
 static_assert(MAX_THREAD_COUNT > 0, "invalid MAX_THREAD_COUNT");
 
+#ifndef MAX_GAME_HISTORY
+#define MAX_GAME_HISTORY 128
+#endif
+
 struct search_description {
 	int depth;
 	int depth_limit;
 
 	struct hash_table *tt;
 
-	// todo: const struct hash_table *tt_paralell[MAX_THREAD_COUNT];
+	struct move_history *move_history;
 
-	struct position repeated_positions[26];
+	/*
+	 * Zobrist keys of the positions preceding the root position in the
+	 * game since the last irreversible move, the latest one first.
+	 */
+	uint64_t game_history[MAX_GAME_HISTORY][2];
+	unsigned game_history_length;
 
 	uintmax_t time_limit;
 	taltos_systime thinking_started;
 
 	uintmax_t node_count_limit;
 
+	/*
+	 * The value found by the previous iteration, used for setting up
+	 * an aspiration window around it at the root.
+	 */
+	int previous_value;
+	bool is_previous_value_valid;
+
 	struct search_settings settings;
 };
 
@@ -72,6 +88,10 @@ struct search_result {
 	uintmax_t qnode_count;
 	uintmax_t cutoff_count;
 	uintmax_t first_move_cutoff_count;
+	unsigned aspiration_research_count;
+	uintmax_t pawn_cache_probes;
+	uintmax_t pawn_cache_hits;
+	struct move_order_stats move_order_stats;
 	move pv[MAX_PLY];
 };
 
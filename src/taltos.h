@@ -39,12 +39,41 @@ struct search_settings {
 	bool use_LMR; // Late Move Reductions
 	bool use_LMP; // Late Move Pruning
 	bool use_null_moves; // Recursive null move pruning
-	bool use_pv_cleanup;
+	bool use_futility_pruning; // Futility pruning of quiet moves
+	bool use_reverse_futility_pruning; // Static null move pruning
+	bool use_qsearch_pruning; // Delta and SEE pruning in quiescence
+	bool use_singular_extensions;
 	bool use_repetition_check;
 	bool use_strict_repetition_check;
 	bool use_advanced_move_order;
 	bool use_history_heuristics;
 	bool use_beta_extensions;
+	bool use_aspiration_windows;
+	bool use_move_order_timing;
+
+	/*
+	 * Quiet moves are ordered without describing them beyond this
+	 * move index, or at any index at depths up to cheap_move_order_depth
+	 */
+	unsigned cheap_move_order_index;
+	int cheap_move_order_depth;
+
+	/*
+	 * Margins of futility pruning and reverse futility pruning, indexed
+	 * by the remaining depth in plies, used at depths 1 to 3. Index zero
+	 * is not used by search, nodes with less than a ply of depth left
+	 * are not pruned this way.
+	 */
+	int futility_margins[4];
+	int reverse_futility_margins[4];
+
+	/*
+	 * Singular extensions are tried from singular_extension_depth on,
+	 * the other moves must stay below the hash value by
+	 * singular_extension_margin centipawns per ply of depth
+	 */
+	int singular_extension_depth;
+	int singular_extension_margin;
 
 	/*
 	 * TODO: try these
@@ -64,6 +93,7 @@ struct taltos_conf {
 	bool timing;
 	taltos_systime start_time;
 	unsigned hash_table_size_mb;
+	unsigned thread_count;
 	char *book_path;
 	enum book_type book_type;
 	bool use_unicode;
@@ -31,6 +31,10 @@
 #define _POSIX_C_SOURCE 199309L
 #endif
 
+#ifdef TALTOS_CAN_USE_POSIX_MMAP
+#define _DEFAULT_SOURCE
+#endif
+
 #ifdef TALTOS_CAN_USE_POSIX_FSTAT
 #include <stdio.h>
 #include <sys/stat.h>
@@ -48,6 +52,10 @@
 #include <sys/resource.h>
 #endif
 
+#ifdef TALTOS_CAN_USE_POSIX_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifndef TALTOS_CAN_USE_ISO_ALIGNAD_ALLOC
 #ifdef TALTOS_CAN_USE_INTEL_MMALLOC
 #include <xmmintrin.h>
@@ -140,6 +148,131 @@ xaligned_calloc(size_t alignment, size_t count, size_t size)
 	return address;
 }
 
+/*
+ * Blocks at least as large as a huge page are allocated using
+ * a size rounded up to the huge page size, and aligned to a huge page
+ * boundary, so they can be fully backed by huge pages.
+ */
+static const size_t huge_page_size = 2 * 1024 * 1024;
+
+static size_t
+large_alloc_size(size_t size)
+{
+	if (size < huge_page_size)
+		return size;
+
+	return ((size + huge_page_size - 1) / huge_page_size) * huge_page_size;
+}
+
+static size_t
+large_alloc_alignment(size_t size)
+{
+	if (size < huge_page_size)
+		return 4096;
+
+	return huge_page_size;
+}
+
+void*
+large_alloc(size_t size, enum memory_backing *backing)
+{
+	void *address;
+
+	size = large_alloc_size(size);
+
+#ifdef TALTOS_CAN_USE_MAP_HUGETLB
+	if (size >= huge_page_size) {
+		address = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (address != MAP_FAILED) {
+			*backing = mb_huge_pages;
+			return address;
+		}
+	}
+#endif
+
+	address = aligned_alloc(large_alloc_alignment(size), size);
+	if (address == NULL)
+		return NULL;
+
+	*backing = mb_default_pages;
+
+#ifdef TALTOS_CAN_USE_MADV_HUGEPAGE
+	if (size >= huge_page_size
+	    && madvise(address, size, MADV_HUGEPAGE) == 0)
+		*backing = mb_transparent_huge_pages;
+#endif
+
+	return address;
+}
+
+void*
+large_map_file(FILE *file, size_t offset, size_t size,
+		enum memory_backing *backing)
+{
+#ifdef TALTOS_CAN_USE_POSIX_MMAP
+	void *address;
+
+	if (fflush(file) != 0)
+		return NULL;
+
+	address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+	    fileno(file), (off_t)offset);
+	if (address == MAP_FAILED)
+		return NULL;
+
+	*backing = mb_file_mapping;
+	return address;
+#else
+	(void) file;
+	(void) offset;
+	(void) size;
+	(void) backing;
+	return NULL;
+#endif
+}
+
+void
+large_free(void *address, size_t size, enum memory_backing backing)
+{
+	if (address == NULL)
+		return;
+
+#ifdef TALTOS_CAN_USE_POSIX_MMAP
+	if (backing == mb_file_mapping) {
+		(void) munmap(address, size);
+		return;
+	}
+#endif
+
+#ifdef TALTOS_CAN_USE_MAP_HUGETLB
+	if (backing == mb_huge_pages) {
+		(void) munmap(address, large_alloc_size(size));
+		return;
+	}
+#else
+	(void) size;
+#endif
+
+	(void) backing;
+	xaligned_free(address);
+}
+
+const char*
+memory_backing_name(enum memory_backing backing)
+{
+	switch (backing) {
+	case mb_huge_pages:
+		return "huge pages";
+	case mb_transparent_huge_pages:
+		return "transparent huge pages";
+	case mb_file_mapping:
+		return "file mapping";
+	default:
+		return "default pages";
+	}
+}
+
 /*CSTYLED*/
 // https://www.securecoding.cert.org/confluence/display/c/FIO19-C.+Do+not+use+fseek%28%29+and+ftell%28%29+to+compute+the+size+of+a+regular+file
 /*
@@ -239,6 +372,33 @@ xseconds_since(taltos_systime some_time_ago)
 #endif
 }
 
+uintmax_t
+xnanoseconds_since(taltos_systime some_time_ago)
+{
+#ifdef TALTOS_CAN_USE_MACH_ABS_TIME
+
+	uint64_t now = mach_absolute_time();
+
+	return (now - some_time_ago) * timebase_info.numer / timebase_info.denom;
+
+#elif defined(TALTOS_CAN_USE_CLOCK_GETTIME)
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uintmax_t)(now.tv_sec - some_time_ago.tv_sec) * 1000000000
+	    + now.tv_nsec - some_time_ago.tv_nsec;
+
+#elif defined(TALTOS_CAN_USE_W_PERFCOUNTER)
+
+	return (xnow() - some_time_ago) * 1000000000
+	    / pcounter_frequency.QuadPart;
+
+#else
+#error unable to use monotonic clock
+#endif
+}
+
 uintmax_t
 get_big_endian_num(size_t size, const unsigned char str[size])
 {
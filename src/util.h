@@ -64,6 +64,39 @@ void *xaligned_calloc(size_t alignment, size_t count, size_t size)
 
 void xaligned_free(void*);
 
+/*
+ * Allocating large blocks of memory, e.g. the transposition table.
+ * Where the platform allows, these are backed by huge pages, to avoid
+ * most TLB misses while accessing such memory at random addresses.
+ * The backing actually obtained is reported via the enum memory_backing
+ * argument, which must also be passed to large_free along with the size.
+ * The memory returned is at least page aligned.
+ * large_alloc returns NULL on failure.
+ */
+enum memory_backing {
+	mb_default_pages,
+	mb_transparent_huge_pages,
+	mb_huge_pages,
+	mb_file_mapping
+};
+
+void *large_alloc(size_t size, enum memory_backing*)
+	attribute(warn_unused_result, nonnull);
+
+/*
+ * Map size bytes of a file, starting at a page aligned offset, into memory.
+ * The mapping is private, modifications of the memory are not written back
+ * to the file. The result must be released using large_free, just as
+ * memory from large_alloc. Returns NULL if memory mapping is not supported,
+ * or on failure.
+ */
+void *large_map_file(FILE*, size_t offset, size_t size, enum memory_backing*)
+	attribute(warn_unused_result, nonnull);
+
+void large_free(void*, size_t size, enum memory_backing);
+
+const char *memory_backing_name(enum memory_backing);
+
 int bin_file_size(FILE*, size_t*)
 	attribute(warn_unused_result, nonnull(2));
 
@@ -78,6 +111,7 @@ typedef uint64_t taltos_systime;
 
 taltos_systime xnow(void);
 uintmax_t xseconds_since(taltos_systime);
+uintmax_t xnanoseconds_since(taltos_systime);
 uintmax_t get_big_endian_num(size_t size, const unsigned char[size]);
 
 char *xstrtok_r(char *restrict str, const char *restrict sep,
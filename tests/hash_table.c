@@ -120,6 +120,87 @@ verify_entry4(ht_entry entry)
 	assert(ht_move(entry) == create_move_g(sq_c2, sq_c3, queen, 0));
 }
 
+static ht_entry
+aging_entry(int depth)
+{
+	return ht_set_value(ht_set_depth(HT_NULL, depth), vt_exact, depth);
+}
+
+/*
+ * Fill the deep slots of a bucket with deep entries, and check that
+ * a shallow entry can only replace one of them after a new generation
+ * is started.
+ */
+static void
+test_aging(struct hash_table *table, const struct position *pos)
+{
+	struct position p = *pos;
+
+	ht_clear(table);
+	for (int i = 0; i < 6; ++i) {
+		p.zhash[1] = pos->zhash[1] + i + 1;
+		ht_pos_insert(table, &p, aging_entry(50));
+		assert(ht_depth(ht_lookup_deep(table, &p, 1, 0)) == 50);
+	}
+	assert(ht_usage(table) == 6);
+
+	p.zhash[1] = pos->zhash[1] + 100;
+	ht_pos_insert(table, &p, aging_entry(10));
+	assert(!ht_is_set(ht_lookup_deep(table, &p, 1, 0)));
+
+	ht_next_generation(table);
+
+	p.zhash[1] = pos->zhash[1] + 101;
+	ht_pos_insert(table, &p, aging_entry(10));
+	assert(ht_depth(ht_lookup_deep(table, &p, 1, 0)) == 10);
+	assert(ht_value(ht_lookup_deep(table, &p, 1, 0)) == 10);
+	assert(ht_value_type(ht_lookup_deep(table, &p, 1, 0)) == vt_exact);
+	assert(ht_usage(table) == 6);
+
+	int old_count = 0;
+	for (int i = 0; i < 6; ++i) {
+		p.zhash[1] = pos->zhash[1] + i + 1;
+		if (ht_is_set(ht_lookup_deep(table, &p, 1, 0)))
+			++old_count;
+	}
+	assert(old_count == 5);
+}
+
+/*
+ * Write the table to a file, and check the entries in the table loaded
+ * from it.
+ */
+static void
+test_save_load(const struct hash_table *table,
+		const struct position *pos1,
+		const struct position *pos2)
+{
+	static const char path[] = "hash_table_test.bin";
+	struct hash_table *loaded;
+
+	assert(ht_save(table, path) == 0);
+	loaded = ht_load(path);
+	(void) remove(path);
+
+	assert(loaded != NULL);
+	assert(ht_size(loaded) == ht_size(table));
+	assert(ht_usage(loaded) == ht_usage(table));
+	assert(ht_lookup_deep(loaded, pos1, 1, 0)
+	    == ht_lookup_deep(table, pos1, 1, 0));
+	assert(ht_lookup_deep(loaded, pos2, 1, 0)
+	    == ht_lookup_deep(table, pos2, 1, 0));
+	assert(ht_lookup_fresh(loaded, pos2) == ht_lookup_fresh(table, pos2));
+
+	// The loaded table is usable just as any other table
+	ht_pos_insert(loaded, pos1, set_entry2());
+	verify_entry2(ht_lookup_fresh(loaded, pos1));
+	verify_entry1(ht_lookup_fresh(table, pos1));
+
+	ht_destroy(loaded);
+
+	assert(ht_load(path) == NULL);
+}
+
 void
 run_tests(void)
 {
@@ -207,5 +288,15 @@ run_tests(void)
 	verify_entry3(ht_lookup_deep(table, &pos2, 3, 0));
 	verify_entry3(ht_lookup_fresh(table, &pos2));
 
+	test_save_load(table, &pos1, &pos2);
+
+	// Smaller than a megabyte, but not resized by a resize to one megabyte
+	assert(ht_size_mb(table) == 1);
+	assert(ht_resize_mb(table, 1) == table);
+	assert(ht_size(table) == (8 * 16) * (1 << 6));
+	verify_entry3(ht_lookup_fresh(table, &pos2));
+
+	test_aging(table, &pos1);
+
 	ht_destroy(table);
 }
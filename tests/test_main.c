@@ -34,6 +34,7 @@
 #include "constants.h"
 #include "hash.h"
 #include "game.h"
+#include "position.h"
 
 int prog_argc;
 const char **prog_argv;
@@ -46,6 +47,7 @@ main(int argc, const char **argv)
 	prog_argv = argv;
 
 	init_zhash_table();
+	init_slider_attacks();
 
 	run_tests();
 
@@ -43,6 +43,8 @@ static uint64_t l_bishop_masks[64];
 static uint64_t l_rook_masks[64];
 static uint64_t l_pawn_attacks_north[64];
 static uint64_t l_pawn_attacks_south[64];
+static uint64_t l_bishop_magics[64];
+static uint64_t l_rook_magics[64];
 
 static const int king_dirs_h[] = { 1, 1, 1, 0, -1, -1, -1, 0};
 static const int king_dirs_v[] = { -1, 0, 1, 1, 1, 0, -1, -1};
@@ -123,6 +125,119 @@ gen_pawn_attacks(void)
 		l_pawn_attacks_south[i] = pawn_reach_south(bit64(i));
 }
 
+/*
+ * Magic multipliers for sliding attack lookups, see init_slider_attacks
+ * in position.c. The relevant occupancy masks are the same as the
+ * bishop/rook masks, without the last square in each direction.
+ */
+static uint64_t
+gen_blocked_ray(int i, int dir, uint64_t edge, uint64_t occupied)
+{
+	uint64_t bit = bit64(i);
+	uint64_t ray = EMPTY;
+
+	while (is_empty(edge & bit)) {
+		i += dir;
+		bit = bit64(i);
+		ray |= bit;
+		if (is_nonempty(occupied & bit))
+			break;
+	}
+
+	return ray;
+}
+
+static uint64_t
+gen_slider_attacks(int i, const int *dirs, const uint64_t *edges,
+		uint64_t occupied)
+{
+	uint64_t attacks = EMPTY;
+
+	for (int d = 0; d < 4; ++d)
+		attacks |= gen_blocked_ray(i, dirs[d], edges[d], occupied);
+
+	return attacks;
+}
+
+static uint64_t
+gen_relevant_mask(int i, const int *dirs, const uint64_t *edges)
+{
+	uint64_t mask = EMPTY;
+
+	for (int d = 0; d < 4; ++d)
+		mask |= gen_ray(i, dirs[d], edges[d]) & ~edges[d];
+
+	return mask;
+}
+
+static uint64_t
+magic_random(void)
+{
+	static uint64_t state = UINT64_C(0x2f6e8b5a91c4d37);
+
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * UINT64_C(2685821657736338717);
+}
+
+static uint64_t
+find_magic(int i, const int *dirs, const uint64_t *edges)
+{
+	static uint64_t occupancy[0x1000];
+	static uint64_t reference[0x1000];
+	static uint64_t attacks[0x1000];
+	static unsigned epoch[0x1000];
+	static unsigned current_epoch = 0;
+
+	uint64_t mask = gen_relevant_mask(i, dirs, edges);
+	int shift = 64 - popcnt(mask);
+	size_t size = 0;
+	uint64_t subset = EMPTY;
+
+	do {
+		occupancy[size] = subset;
+		reference[size] = gen_slider_attacks(i, dirs, edges, subset);
+		++size;
+		subset = (subset - mask) & mask;
+	} while (subset != EMPTY);
+
+	for (;;) {
+		uint64_t magic;
+		size_t j;
+
+		do {
+			magic = magic_random() & magic_random() & magic_random();
+		} while (popcnt((magic * mask) >> 56) < 6);
+
+		++current_epoch;
+		for (j = 0; j < size; ++j) {
+			size_t index = (occupancy[j] * magic) >> shift;
+
+			if (epoch[index] < current_epoch) {
+				epoch[index] = current_epoch;
+				attacks[index] = reference[j];
+			}
+			else if (attacks[index] != reference[j]) {
+				break;
+			}
+		}
+
+		if (j == size)
+			return magic;
+	}
+}
+
+static void
+gen_magics(void)
+{
+	for (int i = 0; i < 64; ++i)
+		l_bishop_magics[i] = find_magic(i, bishop_dirs, bishop_edges);
+
+	for (int i = 0; i < 64; ++i)
+		l_rook_magics[i] = find_magic(i, rook_dirs, rook_edges);
+}
+
 static void
 print_uint64(uint64_t value)
 {
@@ -157,6 +272,7 @@ gen_tables(void)
 	gen_masks(l_bishop_masks, 4, bishop_dirs, bishop_edges);
 	gen_masks(l_rook_masks, 4, rook_dirs, rook_edges);
 	gen_pawn_attacks();
+	gen_magics();
 }
 
 static void
@@ -181,6 +297,10 @@ print_tables(void)
 	print_table(l_pawn_attacks_north, "pawn_attacks_north");
 	putchar('\n');
 	print_table(l_pawn_attacks_south, "pawn_attacks_south");
+	putchar('\n');
+	print_table(l_bishop_magics, "bishop_magic_numbers");
+	putchar('\n');
+	print_table(l_rook_magics, "rook_magic_numbers");
 }
 
 static void
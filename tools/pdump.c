@@ -158,6 +158,7 @@ main(int argc, char **argv)
 		return EXIT_FAILURE;
 
 	init_zhash_table();
+	init_slider_attacks();
 
 	struct game *g = game_create_fen(buf);
 	if (g == NULL)
@@ -213,19 +214,6 @@ main(int argc, char **argv)
 	printf("\noffset 0x%zx: .bq\n", offsetof(struct position, bq));
 	dump_bitboard_pairs(1, pos->bq);
 
-	printf("\noffset 0x%zx: .rays[0]\n", offsetof(struct position, rays));
-	for (int r = 0; r < 8; ++r) {
-		dump_bitboards(8, pos->rays[0] + r * 8);
-		putchar('\n');
-	}
-
-	printf("\noffset 0x%zx: .rays[1]\n",
-	       offsetof(struct position, rays) + sizeof(pos->rays[0]));
-	for (int r = 0; r < 8; ++r) {
-		dump_bitboards(8, pos->rays[1] + r * 8);
-		putchar('\n');
-	}
-
 	printf("\noffset 0x%zx: .zhash\n", offsetof(struct position, zhash));
 	printf(" 0x%016" PRIx64 " 0x%016" PRIx64 "\n\n",
 	       pos->zhash[0], pos->zhash[1]);